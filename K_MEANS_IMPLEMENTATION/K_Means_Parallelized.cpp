@@ -11,6 +11,11 @@
 #include <sstream>
 #include <algorithm>
 #include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
 
 using namespace std;
 using namespace std::chrono;
@@ -22,6 +27,35 @@ using namespace std::chrono;
 */
 
 
+/*
+    Parsing one line of the CSV file into the x and y coordinates of a point
+*/
+void parse_line(const string& line, float* point) {
+
+    // Using istringstream to parse the line string
+    istringstream iss(line);
+
+    // Declaring coord variable to store the floating-point values representing coordinates of a point
+    float coord;
+
+    // Declaring delimiter variable to temporarily hold the character that separates the coordinates in the file
+    char delimiter;
+
+    // While loop that is for extracting data from the iss variable
+    while (iss >> coord >> delimiter) {
+
+        // Assigning the value of coord to the fisrt coordinate (x-coordinate)
+        point[0] = coord;
+
+        // This line attempt to read the next value into coord again
+        iss >> coord >> delimiter;
+
+        // Assigning the value of coord to the second coordinate (y-coordinate)
+        point[1] = coord;
+    }
+
+}
+
 /*
     Reading data from a CSV file
 */
@@ -50,41 +84,44 @@ void load_CSV(string file_name, float** points, long long int size) {
     // While loop for processing each line
     while (getline(in, line) && point_number < size) {
 
-        // Using istringstream to parse the line string
-        istringstream iss(line);
+        // Parsing the coordinates of the point
+        parse_line(line, points[point_number]);
+
+        // Incrementing the point number variable after processing each variable
+        point_number++;
+    }
 
-        // Declaring coord variable to store the floating-point values representing coordinates of a point
-        float coord;
+    // Closing the file after reading all necessary data
+    in.close();
 
-        // Declaring delimiter variable to temporarily hold the character that separates the coordinates in the file
-        char delimiter;
+}
 
-        // While loop that is for extracting data from the iss variable
-        while (iss >> coord >> delimiter) {
+/*
+    Inverting a permutation of the point store: order[i] is the original row of the ith stored point, and inverse
+    receives, for every original row, the position where it is stored now
+*/
+void invert_order(const long long int* order, long long int size, vector<long long int>& inverse) {
 
-            // Assigning the value of coord to the fisrt coordinate (x-coordinate)
-            points[point_number][0] = coord;
+    // Allocating one entry per point
+    inverse.resize(size);
 
-            // This line attempt to read the next value into coord again
-            iss >> coord >> delimiter;
+    // OpenMP Directive: every entry of the inverse permutation is written by exactly one iteration
+    #pragma omp parallel for
+    // For loop to invert the permutation
+    for (long long int i = 0; i < size; i++) {
 
-            // Assigning the value of coord to the second coordinate (y-coordinate)
-            points[point_number][1] = coord;
-        }
+        // The point stored at position i came from row order[i]
+        inverse[order[i]] = i;
 
-        // Incrementing the point number variable after processing each variable
-        point_number++;
     }
 
-    // Closing the file after reading all necessary data
-    in.close();
-
 }
 
 /*
-    Writing data to a CSV file
+    Writing data to a CSV file. When the points were reordered along a space-filling curve, order[i] holds the
+    original row of the ith stored point, and the rows are written back in their original file order
 */
-void save_to_CSV(string file_name, float** points, long long int size) {
+void save_to_CSV(string file_name, float** points, long long int size, const long long int* order = nullptr) {
     ofstream fout(file_name);
 
     // Checking if the file was successfully opened for writing
@@ -98,11 +135,22 @@ void save_to_CSV(string file_name, float** points, long long int size) {
 
     }
 
+    // Declaring the inverse permutation, mapping each original row to the position where it is stored now
+    vector<long long int> inverse;
+
+    // Checking if the points were reordered
+    if (order != nullptr) {
+        invert_order(order, size, inverse);
+    }
+
     // For loop to iterate over each in the points array
     for (long long int i = 0; i < size; i++) {
 
+        // Selecting the stored point that belongs to the ith row of the original file
+        const float* point = (order != nullptr) ? points[inverse[i]] : points[i];
+
         // Writing the x-coordindate, the y-coordinate and the cluster id
-        fout << points[i][0] << "," << points[i][1] << "," << points[i][2] << "\n";
+        fout << point[0] << "," << point[1] << "," << point[2] << "\n";
     }
 
     // Closing the file
@@ -111,297 +159,2963 @@ void save_to_CSV(string file_name, float** points, long long int size) {
 }
 
 /* 
-    IMPLEMENTING K_MEANS 
+    DEFINING Random number and Reduction FUNCTIONS
 */
 
-/** K-Means function
- *  Performs the k-means algorithm in parallel to cluster data points into groups.
- *  Array of data points where each row represents a point with "x", "y" coordinates and its cluster assignment
- *  @param points  
- *  Number of desired clusters
- *  @param num_clusters 
- *  Data set size (number of points).    
- *  @param size
- *  Maximum number of iterations allowed for the algorithm           
- *  @param max_iterations 
- */
+// Independent random streams, one per phase of the algorithms. The low 32 bits of a stream carry the iteration,
+// reduction number or tree node within the phase
+const unsigned long long int STREAM_INITIAL_LABELS = 1ULL << 32;
+const unsigned long long int STREAM_CENTROID_SEEDING = 2ULL << 32;
+const unsigned long long int STREAM_CORESET_SAMPLING = 3ULL << 32;
+const unsigned long long int STREAM_KMEANSPP = 4ULL << 32;
+const unsigned long long int STREAM_HIERARCHICAL = 5ULL << 32;
 
-void kmeans_paralelo(float** points, int num_clusters, long long int size, int max_iterations) {
+// Number of consecutive values combined by one partial sum. It does not depend on the number of threads, so the
+// floating-point sums are the same at any thread count
+const long long int REDUCTION_BLOCK = 8192;
 
-    // Generating a uniformly-distributed integer random number
-    std::random_device rd;
+// Maximum number of partial sums per cluster in cluster_sums. A fixed number of groups rather than a fixed group size
+// keeps the partial sums at O(num_clusters) memory for any number of points
+const long long int REDUCTION_GROUPS = 256;
 
-    // Generating a randon number based on the Mersenne Twister algorithm
-    std::mt19937 gen(rd());
-    
-    // Generating a random integer within a specified range, here between o and cluster number -1
-    std::uniform_int_distribution<int> distribution(0, num_clusters - 1);
+/*
+    Philox4x32-10 counter-based generator. The four output words depend only on the counter (stream, index) and the
+    key (seed), so any thread can draw the random numbers of any point without sharing generator state
+*/
+void philox4x32(unsigned int counter[4], unsigned int key[2]) {
 
-    // OpenMP Directive:  instructs the compiler to parallelize the loop that follows. OpenMP automatically 
-    // divides the loop's iterations among the available threads, allowing the loop to execute much faster on multicore 
-    // processors
-    #pragma omp parallel for
-    //For loop to iterate over all data points
-    for (long long int i = 0; i < size; i++) {
+    // For loop over the ten rounds of the generator
+    for (int round = 0; round < 10; round++) {
+
+        // Multiplying two counter words by the Philox constants
+        unsigned long long int p0 = 0xD2511F53ULL * counter[0];
+        unsigned long long int p1 = 0xCD9E8D57ULL * counter[2];
+
+        // Mixing the high halves of the products with the other words and the key
+        unsigned int c0 = (unsigned int)(p1 >> 32) ^ counter[1] ^ key[0];
+        unsigned int c2 = (unsigned int)(p0 >> 32) ^ counter[3] ^ key[1];
+        counter[0] = c0;
+        counter[1] = (unsigned int)p1;
+        counter[2] = c2;
+        counter[3] = (unsigned int)p0;
+
+        // Bumping the key with the Weyl sequence constants
+        key[0] += 0x9E3779B9u;
+        key[1] += 0xBB67AE85u;
 
-        // Assigning each points clustr assignment is determined by generating a random number
-        points[i][2] = distribution(gen); 
-                                          
     }
 
-    // Converge auxiliar variable that acts as a flag indicating whether the algorithm has converged - meaning that further do
-    // not siginifcatly change the outcome, usually defined as the cenroid of clusters no longer moving 
-    bool converge = false; 
+}
 
-    // Integer auxuliar variable that counts the number if iterations the algorithm has performed.
-    int cuenta = 0;
+/*
+    64 random bits for draw number index of the given stream
+*/
+unsigned long long int random_bits(unsigned long long int seed, unsigned long long int stream, unsigned long long int index) {
 
-    // While loop that perfomr the iterative process of the algorithm       
-    while (!converge && cuenta < max_iterations) {
+    // Building the counter from the index and the stream, and the key from the seed
+    unsigned int counter[4] = {(unsigned int)index, (unsigned int)(index >> 32), (unsigned int)stream, (unsigned int)(stream >> 32)};
+    unsigned int key[2] = {(unsigned int)seed, (unsigned int)(seed >> 32)};
 
-        // Setting auxiliar converge variable on true 
-        converge = true;
+    // Running the generator
+    philox4x32(counter, key);
 
-        // Incrementing to track the number of iterations the algorithm has performed
-        cuenta++;
+    // Returning the first two output words
+    return ((unsigned long long int)counter[0] << 32) | counter[1];
 
-        // Dynamically allocating memory for centroids array, representing the coordinates of the centroids
-        float** centroids = new float*[num_clusters]; 
+}
 
-        // Dynamically allocating memory for counts array, this is to keep track of the number of points assigned to each cluster
-        int* counts = new int[num_clusters];          
+/*
+    Uniform double in [0, 1) for draw number index of the given stream
+*/
+double random_uniform(unsigned long long int seed, unsigned long long int stream, unsigned long long int index) {
 
-        // Declaring a vector to store the indices of data points chosen as initial centroids
-        std::vector<int> centroid_indices;
+    // Using the upper 53 bits as the mantissa
+    return (random_bits(seed, stream, index) >> 11) * (1.0 / 9007199254740992.0);
 
-        // While loop to iterate that is going to continue as lonsg as the number of slected indices is less than the deisreed number of clusters. This
-        // conditiion ensures that you select a unique index for each cluster
-        while (centroid_indices.size() < num_clusters) {
+}
 
-            // Generating a random index using a uniform integer distributtion
-            int index = distribution(gen); 
+/*
+    Uniform integer in [0, n) for draw number index of the given stream
+*/
+int random_int(unsigned long long int seed, unsigned long long int stream, unsigned long long int index, int n) {
 
-            // Checcking uniqueness
-            if (std::find(centroid_indices.begin(), centroid_indices.end(), index) == centroid_indices.end()) {
+    // Scaling the upper 32 bits to the range (multiply-shift)
+    return (int)(((random_bits(seed, stream, index) >> 32) * (unsigned long long int)n) >> 32);
 
-                // Adding the unique index
-                centroid_indices.push_back(index);
+}
 
-            }
+/*
+    Sum of term(i) for i in [0, n), computed in parallel over blocks of REDUCTION_BLOCK values whose partial sums are
+    added in block order
+*/
+template <typename Term>
+double block_sum(long long int n, Term term) {
 
+    // Partial sum of every block
+    const long long int num_blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    vector<double> partial(num_blocks, 0.0);
+
+    // OpenMP Directive: each block is summed by one thread
+    #pragma omp parallel for
+    for (long long int b = 0; b < num_blocks; b++) {
+        for (long long int i = b * REDUCTION_BLOCK; i < min(n, (b + 1) * REDUCTION_BLOCK); i++) {
+            partial[b] += term(i);
         }
+    }
 
-        // For loop to iterate over the numbr of clusters
-        for (int i = 0; i < num_clusters; i++) {
+    // Adding the partial sums in block order
+    double total = 0.0;
+    for (long long int b = 0; b < num_blocks; b++) {
+        total += partial[b];
+    }
 
-            // For each cluster, this line isdynamically allocates memory for an array of two float values, which represent the x and y coordinates of the centroid
-            centroids[i] = new float[2]{points[centroid_indices[i]][0], points[centroid_indices[i]][1]};
+    // Returning the sum
+    return total;
 
-            // Initializing the count of data associated with the ith cluster to 0
-            counts[i] = 0;
+}
 
-        }
+/*
+    Per-cluster weighted coordinate sums (x, y pairs) and total weights
+*/
+struct ClusterSums {
+    vector<double> sums;
+    vector<double> totals;
+};
 
-        // OpenMP Directive:  instructs the compiler to parallelize the loop that follows. OpenMP automatically 
-        // divides the loop's iterations among the available threads, allowing the loop to execute much faster on multicore 
-        // processors
-        #pragma omp parallel for
-        // For loop iterating all over the points in the dataset
-        for (long long int i = 0; i < size; i++) {
-            
-            // For each point, retrieves the cluster assignment from the third position of its array
-            int cluster = (int)points[i][2];
-
-            // OpenMP Directive: ensures that these additions are done atomically, preventing race conditions when multiple threads try to update the coordinates of the 
-            // same centroid simultaneously. Atomic operations are critical in parallel computing to ensure data integrity when shared data is being updated.
-            #pragma omp atomic
-            // Updating centroid coordindates (x-coordinate)
-            centroids[cluster][0] += points[i][0];  
-            // OpenMP Directive: ensures that these additions are done atomically, preventing race conditions when multiple threads try to update the coordinates of the 
-            // same centroid simultaneously. Atomic operations are critical in parallel computing to ensure data integrity when shared data is being updated. 
-            #pragma omp atomic
-            // Updating centroid coordindates (x-coordinate)
-            centroids[cluster][1] += points[i][1];
-            // OpenMP Directive: ensures that these additions are done atomically, preventing race conditions when multiple threads try to update the coordinates of the 
-            // same centroid simultaneously. Atomic operations are critical in parallel computing to ensure data integrity when shared data is being updated.   
-            #pragma omp atomic
-            // Incrementing the count of points assigned to the cluster  
-            counts[cluster]++;
+/*
+    Number of REDUCTION_BLOCK blocks in each reduction group of cluster_sums over n points. The groups are runs of
+    whole blocks, at most REDUCTION_GROUPS of them, and depend only on n
+*/
+long long int group_blocks(long long int n) {
+    const long long int num_blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    return max(1LL, (num_blocks + REDUCTION_GROUPS - 1) / REDUCTION_GROUPS);
+}
+
+/*
+    Accumulating points [first, last) of one reduction group into its partial sums: block[3 * j] and block[3 * j + 1]
+    receive the weighted coordinates of cluster j and block[3 * j + 2] its weight. point_at(i, cluster, x, y, w)
+    reads the ith point
+*/
+template <typename PointAt>
+void cluster_block_sums(long long int first, long long int last, PointAt point_at, double* block) {
+    for (long long int i = first; i < last; i++) {
+        int cluster;
+        double x, y, w;
+        point_at(i, cluster, x, y, w);
+        block[3 * cluster] += w * x;
+        block[3 * cluster + 1] += w * y;
+        block[3 * cluster + 2] += w;
+    }
+}
+
+/*
+    Adding the partial sums of num_groups reduction groups, in group order
+*/
+void combine_cluster_sums(const vector<double>& partial, long long int num_groups, int num_clusters, vector<double>& sums, vector<double>& totals) {
+
+    // Allocating the results
+    sums.assign(2 * num_clusters, 0.0);
+    totals.assign(num_clusters, 0.0);
 
+    // OpenMP Directive: each cluster adds the partial sums of all groups, in group order
+    #pragma omp parallel for
+    for (int j = 0; j < num_clusters; j++) {
+        for (long long int g = 0; g < num_groups; g++) {
+            const double* block = partial.data() + g * 3 * (long long int)num_clusters;
+            sums[2 * j] += block[3 * j];
+            sums[2 * j + 1] += block[3 * j + 1];
+            totals[j] += block[3 * j + 2];
         }
+    }
 
-        // For loop to iterate over each cluster
-        for (int i = 0; i < num_clusters; i++) {
+}
 
-            // If the current cluster has one or more assigned points (counts[i] > 0), the coordinates of its centroid are updated
-            if (counts[i] > 0) {
+/*
+    Per-cluster weighted coordinate sums and total weights of n points. point_at(i, cluster, x, y, w) reads the ith
+    point; sums receives num_clusters x, y pairs and totals num_clusters weights. Each reduction group (see
+    group_blocks) accumulates its own partial sums in point order, and the partial sums are combined in group order,
+    so the memory used is O(num_clusters) whatever the number of points
+*/
+template <typename PointAt>
+void cluster_sums(long long int n, int num_clusters, PointAt point_at, vector<double>& sums, vector<double>& totals) {
 
-                // Updating centroid coordindates (x-coordinate)
-                centroids[i][0] /= counts[i];
+    // Partial sums of every group: 2 coordinates and 1 weight per cluster
+    const long long int group_size = group_blocks(n) * REDUCTION_BLOCK;
+    const long long int num_groups = (n + group_size - 1) / group_size;
+    vector<double> partial(num_groups * 3 * (long long int)num_clusters, 0.0);
 
-                // Updating centroid coordindates (y-coordinate) 
-                centroids[i][1] /= counts[i];
+    // OpenMP Directive: each group is accumulated by one thread into its own partial sums
+    #pragma omp parallel for
+    for (long long int g = 0; g < num_groups; g++) {
+        cluster_block_sums(g * group_size, min(n, (g + 1) * group_size), point_at, partial.data() + g * 3 * (long long int)num_clusters);
+    }
 
-            }
+    // Combining the partial sums
+    combine_cluster_sums(partial, num_groups, num_clusters, sums, totals);
+
+}
+
+/*
+    In-place inclusive prefix sum computed in parallel: every block of REDUCTION_BLOCK values is scanned on its own
+    and then shifted by the total of the blocks that come before it
+*/
+void parallel_prefix_sum(vector<double>& values) {
+
+    // Number of values and number of blocks
+    const long long int n = values.size();
+    const long long int num_blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
 
+    // totals[b + 1] receives the sum of block b
+    vector<double> totals(num_blocks + 1, 0.0);
+
+    // OpenMP Directive: each block is scanned independently by one thread
+    #pragma omp parallel for
+    for (long long int b = 0; b < num_blocks; b++) {
+
+        // Range of the block
+        long long int first = b * REDUCTION_BLOCK;
+        long long int last = min(n, first + REDUCTION_BLOCK);
+
+        // Local scan of the block
+        for (long long int i = first + 1; i < last; i++) {
+            values[i] += values[i - 1];
         }
 
-        // OpenMP Directive:  instructs the compiler to parallelize the loop that follows. OpenMP automatically 
-        // divides the loop's iterations among the available threads, allowing the loop to execute much faster on multicore 
-        // processors. The reduction(&& : converge) clause is used for the converge variable, a boolean flag indicating whether the 
-        // algorithm has converged (i.e., if there were no changes in cluster assignments in this iteration)
-        #pragma omp parallel for reduction(&& : converge)
-        // For loop to iterate all over the points
-        for (long long int i = 0; i < size; i++) {
+        // Storing the total of the block
+        totals[b + 1] = values[last - 1];
 
-            // Initializing min_distance with infity to ensure thata any actual distance calculated will be smaller, helping to find the
-            // minimum distance to a centroid
-            float min_distancia = INFINITY;
+    }
 
-            // Initializing min_cluster -1, indicating that no cluster has been assigned yet
-            int min_cluster = -1;
+    // Accumulating the block totals (one value per block, so this is done serially)
+    for (long long int b = 1; b <= num_blocks; b++) {
+        totals[b] += totals[b - 1];
+    }
 
-            // For loop iterating through the clusters
-            for (int j = 0; j < num_clusters; j++) {
+    // OpenMP Directive: each block is shifted independently by one thread
+    #pragma omp parallel for
+    for (long long int b = 1; b < num_blocks; b++) {
+        for (long long int i = b * REDUCTION_BLOCK; i < min(n, (b + 1) * REDUCTION_BLOCK); i++) {
+            values[i] += totals[b];
+        }
+    }
+
+}
 
-                // Calculating the difference in the x-coordinates between the ith and the jth centroid
-                float distancia_x = points[i][0] - centroids[j][0];
+/* 
+    DEFINING Space-filling curve FUNCTIONS
+*/
 
-                // Calculating the difference in the y-coordinates between the ith and the jth centroid
-                float distancia_y = points[i][1] - centroids[j][1];
+// Curves available for reordering the points before clustering
+const int CURVE_NONE = 0;
+const int CURVE_MORTON = 1;
+const int CURVE_HILBERT = 2;
 
-                // Calculating the euclidean distance
-                float distancia = sqrt(std::pow(distancia_x, 2) + std::pow(distancia_y, 2));
+// Number of consecutive (reordered) points that share a bounding box in the block-level pruning
+const long long int BLOCK_SIZE = 256;
 
-                // Checking if the distance (distancia) from the current data point to the centroid being considered in this iteration is 
-                // less than the smallest distance found so far (min_distancia)
-                if (distancia < min_distancia) {
+// Smallest block used by the hierarchical refinement, which sizes its blocks like its clusters
+const long long int REFINE_MIN_BLOCK = 16;
 
-                    // Updating min_distance variable
-                    min_distancia = distancia;
+// Number of bits per coordinate used when quantizing the points onto the curve grid
+const int CURVE_BITS = 16;
 
-                    // Updating min_cluster to the index of this closer centroid
-                    min_cluster = j;
+/*
+    Bounding boxes of consecutive blocks of points. The box of block b is stored as
+    bounds[4 * b] = min x, bounds[4 * b + 1] = min y, bounds[4 * b + 2] = max x, bounds[4 * b + 3] = max y
+*/
+struct PointBlocks {
+    long long int num_blocks = 0;
+    long long int block_size = BLOCK_SIZE;
+    vector<float> bounds;
+};
 
-                }
+/*
+    Spreading the lower 16 bits of v so that a zero bit is inserted between each pair of consecutive bits
+*/
+unsigned long long int spread_bits(unsigned long long int v) {
 
-            }
+    // Keeping only the bits that belong to the grid coordinate
+    v &= 0xFFFF;
 
-            // Checking if the nearest cluster (min_cluster) identified for the i-th data point is different from the data point's current cluster 
-            // assignment (points[i][2])
-            if (min_cluster != points[i][2]) {
+    // Moving each group of bits to its interleaved position, halving the group size at every step
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
 
-                // Updating cluster assignment
-                points[i][2] = min_cluster;
+    // Returning the spread bits
+    return v;
 
-                // Indicating non-convergence
-                converge = false;
+}
 
-            }
+/*
+    Morton (Z-order) key of a grid cell, interleaving the bits of x and y
+*/
+unsigned long long int morton_key(unsigned int x, unsigned int y) {
 
-        }
+    // The x bits go to the even positions and the y bits to the odd positions
+    return spread_bits(x) | (spread_bits(y) << 1);
 
-        // For loop to iterate over eacj¡h centroid
-        for (int i = 0; i < num_clusters; i++) {
+}
 
-            // Deallocating memory for each array of centroids coordinates
-            delete[] centroids[i];
+/*
+    Hilbert key of a grid cell, walking the curve from the coarsest to the finest level
+*/
+unsigned long long int hilbert_key(unsigned int x, unsigned int y) {
 
-        }
+    // Accumulated distance along the curve
+    unsigned long long int d = 0;
 
-        // Deallocating the memory assigned fot the centroids array
-        delete[] centroids;
+    // For loop over the levels of the curve, from the largest quadrant to the smallest one
+    for (unsigned int s = 1u << (CURVE_BITS - 1); s > 0; s /= 2) {
 
-        // Deallocating the memory assigned for the counts array
-        delete[] counts;
+        // Determining in which quadrant of the current level the cell lies
+        unsigned int rx = (x & s) > 0;
+        unsigned int ry = (y & s) > 0;
+
+        // Adding the number of cells visited before reaching that quadrant
+        d += (unsigned long long int)s * s * ((3 * rx) ^ ry);
+
+        // Rotating the quadrant so that the next level is traversed in the canonical orientation
+        if (ry == 0) {
+
+            // Reflecting the quadrant when it is the lower right one
+            if (rx == 1) {
+                x = s - 1 - (x & (s - 1));
+                y = s - 1 - (y & (s - 1));
+            }
+
+            // Swapping x and y
+            unsigned int t = x;
+            x = y;
+            y = t;
+
+        }
 
     }
 
+    // Returning the distance along the curve
+    return d;
+
 }
 
-/* 
-    MAIN
+/*
+    Sorting (key, original index) pairs in parallel: each thread sorts one chunk and the sorted chunks are merged pairwise
 */
+void parallel_sort_keys(vector<pair<unsigned long long int, long long int>>& keys) {
 
-int main(int argc, char** argv) {
+    // Total number of keys to sort
+    const long long int n = keys.size();
 
-    // Command line argument validation: if fewer than 4 arguments are provided
-    if (argc < 4) {
+    // One chunk per available thread
+    const int num_chunks = omp_get_max_threads();
 
-        // Displaying usage message
-        cerr << "Usage: " << argv[0] << " <data_file.csv> <num_clusters> <output_file.csv>\n";
+    // Computing the boundaries of the chunks
+    vector<long long int> limits(num_chunks + 1);
+    for (int c = 0; c <= num_chunks; c++) {
+        limits[c] = n * c / num_chunks;
+    }
 
-        // Program exit
-        return 1;
+    // OpenMP Directive: each chunk is sorted independently by one thread
+    #pragma omp parallel for
+    // For loop over the chunks
+    for (int c = 0; c < num_chunks; c++) {
+
+        // Sorting the chunk
+        std::sort(keys.begin() + limits[c], keys.begin() + limits[c + 1]);
 
     }
 
-    // Converting the first command-line argument (argv[1]) into a long long int representing the size (number of data points)
-    const long long int size = atoll(argv[1]);
+    // Merging neighbouring sorted runs, doubling the run width at every round
+    for (int width = 1; width < num_chunks; width *= 2) {
 
-    // Converting the second command-line argument (argv[2]) into an integer that represents the number of clusters (num_clusters) to be used in the K-means algorithm
-    const int num_clusters = atoi(argv[2]);
+        // OpenMP Directive: the merges of one round touch disjoint ranges, so they can run at the same time
+        #pragma omp parallel for
+        // For loop over the pairs of runs merged in this round
+        for (int c = 0; c < num_chunks - width; c += 2 * width) {
 
-    // Storing the first command-line argument (argv[1]) as input_file_name
-    const string input_file_name = argv[1];
+            // Merging run [c, c + width) with run [c + width, c + 2 * width)
+            std::inplace_merge(keys.begin() + limits[c], keys.begin() + limits[c + width], keys.begin() + limits[min(c + 2 * width, num_chunks)]);
 
-    // Storing the third command-line argument (argv[3]) as output_file_name_paralelo
-    const string output_file_name_paralelo = argv[3];
+        }
 
-    // Setting a constant max_iterations to 20, defining a cap on the number of iterations the K-means algorithm will perform
-    const int max_iterations = 20;
+    }
 
-    // Determining the maximum number of threads
-    int num_threads = omp_get_max_threads();
+}
+
+/*
+    Computing the bounding box of every block of BLOCK_SIZE consecutive points
+*/
+void build_blocks(float** points, long long int size, PointBlocks& blocks) {
+
+    // Number of blocks, the last one possibly partial
+    blocks.num_blocks = (size + blocks.block_size - 1) / blocks.block_size;
 
-    // Checking if the program has been executed with at least five command line arguments
-    if (argc >= 5) {
+    // Allocating the four bounds of every block
+    blocks.bounds.assign(4 * blocks.num_blocks, 0.0f);
+
+    // OpenMP Directive: each block box is computed by exactly one thread
+    #pragma omp parallel for
+    // For loop over the blocks
+    for (long long int b = 0; b < blocks.num_blocks; b++) {
+
+        // Range of points that belong to the block
+        long long int first = b * blocks.block_size;
+        long long int last = min(first + blocks.block_size, size);
+
+        // Starting the box at the first point of the block
+        float min_x = points[first][0], min_y = points[first][1];
+        float max_x = points[first][0], max_y = points[first][1];
+
+        // Growing the box to contain the rest of the block
+        for (long long int i = first + 1; i < last; i++) {
+            min_x = min(min_x, points[i][0]);
+            min_y = min(min_y, points[i][1]);
+            max_x = max(max_x, points[i][0]);
+            max_y = max(max_y, points[i][1]);
+        }
 
-        // Converting the fourth command-line argument from a string to an integer, which is then assigned to num_threads variable
-        num_threads = atoi(argv[4]);
+        // Storing the box
+        blocks.bounds[4 * b] = min_x;
+        blocks.bounds[4 * b + 1] = min_y;
+        blocks.bounds[4 * b + 2] = max_x;
+        blocks.bounds[4 * b + 3] = max_y;
 
     }
 
-    // Setting the Number of Threads for OpenMP
-    omp_set_num_threads(num_threads);
+}
 
-    // Allocating dynamic memory for an array
-    float** paralelo = new float*[size];
+/*
+    Reordering the points along a space-filling curve so that points close in the plane are also close in memory.
+    order receives the original row of each stored point (used by save_to_CSV) and blocks the box of each block
+*/
+void reorder_points(float** points, long long int size, int curve, vector<long long int>& order, PointBlocks& blocks) {
 
-    // For loop iterating from 0 to size-1, where size presents the total number of data points to be processed
-    for (long long int i = 0; i < size; i++) {
+    // Initializing the bounding box of the whole data set
+    float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
 
-        // Allocating memory for an array of three float values for each ith entry of paralelo array
-        paralelo[i] = new float[3]{0.0, 0.0, -1}; 
-                                                  
+    // OpenMP Directive: the bounding box is obtained with min and max reductions
+    #pragma omp parallel for reduction(min : min_x, min_y) reduction(max : max_x, max_y)
+    // For loop over all the points
+    for (long long int i = 0; i < size; i++) {
+        min_x = min(min_x, points[i][0]);
+        min_y = min(min_y, points[i][1]);
+        max_x = max(max_x, points[i][0]);
+        max_y = max(max_y, points[i][1]);
     }
 
-    // Using our load_csv function 
-    load_CSV(input_file_name, paralelo, size);
+    // Largest cell index of the grid
+    const float grid_max = (float)((1 << CURVE_BITS) - 1);
 
-    // Starting time measuremente
-    double start_paralelo = omp_get_wtime();
+    // Scale factors from coordinates to grid cells, guarding against a degenerate (zero width) data set
+    const float scale_x = (max_x > min_x) ? grid_max / (max_x - min_x) : 0.0f;
+    const float scale_y = (max_y > min_y) ? grid_max / (max_y - min_y) : 0.0f;
 
-    // Executing the K-means Clustering Algorithm
-    kmeans_paralelo(paralelo, num_clusters, size, max_iterations);
+    // Declaring the (key, original index) pairs that are going to be sorted
+    vector<pair<unsigned long long int, long long int>> keys(size);
 
-    // Measuring Execution Time
-    double tiempo_ejecucion_paralelo = omp_get_wtime() - start_paralelo;
+    // OpenMP Directive: every key depends only on its own point
+    #pragma omp parallel for
+    // For loop computing the curve key of each point
+    for (long long int i = 0; i < size; i++) {
 
-    //Reporting Execution Time
-    cout << "Tiempo de ejecución en paralelo: " << tiempo_ejecucion_paralelo << "\n";
-    
-    // Saving Results to a CSV File
-    save_to_CSV(output_file_name_paralelo, paralelo, size);
+        // Quantizing the coordinates onto the grid
+        unsigned int gx = (unsigned int)((points[i][0] - min_x) * scale_x);
+        unsigned int gy = (unsigned int)((points[i][1] - min_y) * scale_y);
 
-    // For loop for deleting sub arrays
-    for (long long int i = 0; i < size; i++) {
+        // Computing the key along the selected curve
+        keys[i].first = (curve == CURVE_HILBERT) ? hilbert_key(gx, gy) : morton_key(gx, gy);
+        keys[i].second = i;
+
+    }
 
-        // Deallocating each of these sub-arrays
-        delete[] paralelo[i];
+    // Sorting the points by their key
+    parallel_sort_keys(keys);
 
+    // Copying the points in curve order into a temporary buffer
+    vector<float> sorted(3 * size);
+    order.resize(size);
+
+    // OpenMP Directive: each position of the buffer is written by exactly one iteration
+    #pragma omp parallel for
+    // For loop gathering the points in their new order
+    for (long long int i = 0; i < size; i++) {
+        order[i] = keys[i].second;
+        sorted[3 * i] = points[order[i]][0];
+        sorted[3 * i + 1] = points[order[i]][1];
+        sorted[3 * i + 2] = points[order[i]][2];
     }
 
+    // OpenMP Directive: writing the reordered points back into the point store
+    #pragma omp parallel for
+    // For loop over the new positions
+    for (long long int i = 0; i < size; i++) {
+        points[i][0] = sorted[3 * i];
+        points[i][1] = sorted[3 * i + 1];
+        points[i][2] = sorted[3 * i + 2];
+    }
+
+    // Computing the bounding box of every block of the reordered points
+    build_blocks(points, size, blocks);
+
+}
+
+// Relative slack added to every pruning bound, so that float rounding in the per-point distances never prunes a tie
+const double PRUNING_SLACK = 1e-5;
+
+/*
+    Squared minimum and maximum distances from the point (x, y) to the box of block b
+*/
+inline void box_distances(const PointBlocks& blocks, long long int b, double x, double y, double& min_distancia, double& max_distancia) {
+
+    // Reading the box of the block
+    const double min_x = blocks.bounds[4 * b], min_y = blocks.bounds[4 * b + 1];
+    const double max_x = blocks.bounds[4 * b + 2], max_y = blocks.bounds[4 * b + 3];
+
+    // Distance along each axis from the point to the box (zero when the point is inside the box range)
+    double dx = max(0.0, max(min_x - x, x - max_x));
+    double dy = max(0.0, max(min_y - y, y - max_y));
+    min_distancia = dx * dx + dy * dy;
+
+    // Distance along each axis from the point to the farthest corner of the box
+    double fx = max(fabs(x - min_x), fabs(x - max_x));
+    double fy = max(fabs(y - min_y), fabs(y - max_y));
+    max_distancia = fx * fx + fy * fy;
+
+}
+
+/*
+    Selecting the centroids that can be the nearest one for some point of block b. A centroid whose minimum distance
+    to the block box exceeds the smallest maximum distance of any centroid to the box can never win inside the block
+*/
+void block_candidates(const PointBlocks& blocks, long long int b, float** centroids, int num_clusters, vector<int>& candidates) {
+
+    // Smallest squared maximum distance from any centroid to the box
+    double cota = INFINITY;
+    double min_distancia, max_distancia;
+    for (int j = 0; j < num_clusters; j++) {
+        box_distances(blocks, b, centroids[j][0], centroids[j][1], min_distancia, max_distancia);
+        cota = min(cota, max_distancia);
+    }
+
+    // Leaving a small relative slack so that float rounding in the per-point distances never prunes a tie
+    cota *= 1.0 + PRUNING_SLACK;
+
+    // Keeping the centroids in increasing index order, so ties are resolved exactly as in the full scan
+    candidates.clear();
+    for (int j = 0; j < num_clusters; j++) {
+        box_distances(blocks, b, centroids[j][0], centroids[j][1], min_distancia, max_distancia);
+        if (min_distancia <= cota) {
+            candidates.push_back(j);
+        }
+    }
+
+}
+
+/*
+    Uniform grid over the centroids, about one centroid per cell. The indices of the centroids of cell c are
+    members[start[c]] to members[start[c + 1] - 1], in increasing order
+*/
+struct CentroidGrid {
+    int cells = 1;
+    double min_x = 0.0, min_y = 0.0;
+    double cell_w = 1.0, cell_h = 1.0;
+    vector<int> start;
+    vector<int> members;
+};
+
+/*
+    Cell of the grid that holds the coordinate value along one axis, clamped to the grid
+*/
+inline int grid_cell(double value, double origin, double width, int cells) {
+    return (int)min((double)(cells - 1), max(0.0, floor((value - origin) / width)));
+}
+
+/*
+    Building the grid over the current centroids (a counting sort of the centroids by cell)
+*/
+void build_centroid_grid(float** centroids, int num_clusters, CentroidGrid& grid) {
+
+    // Bounding box of the centroids
+    double min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    for (int j = 0; j < num_clusters; j++) {
+        min_x = min(min_x, (double)centroids[j][0]);
+        min_y = min(min_y, (double)centroids[j][1]);
+        max_x = max(max_x, (double)centroids[j][0]);
+        max_y = max(max_y, (double)centroids[j][1]);
+    }
+
+    // Square grid with about one centroid per cell
+    grid.cells = max(1, (int)sqrt((double)num_clusters));
+    grid.min_x = min_x;
+    grid.min_y = min_y;
+    grid.cell_w = (max_x > min_x) ? (max_x - min_x) / grid.cells : 1.0;
+    grid.cell_h = (max_y > min_y) ? (max_y - min_y) / grid.cells : 1.0;
+
+    // Counting the centroids of every cell
+    const int num_cells = grid.cells * grid.cells;
+    grid.start.assign(num_cells + 1, 0);
+    vector<int> cell(num_clusters);
+    for (int j = 0; j < num_clusters; j++) {
+        cell[j] = grid_cell(centroids[j][1], grid.min_y, grid.cell_h, grid.cells) * grid.cells
+                + grid_cell(centroids[j][0], grid.min_x, grid.cell_w, grid.cells);
+        grid.start[cell[j] + 1]++;
+    }
+
+    // Turning the counts into the first position of every cell
+    for (int c = 0; c < num_cells; c++) {
+        grid.start[c + 1] += grid.start[c];
+    }
+
+    // Placing the centroids in their cells, in increasing index order
+    grid.members.resize(num_clusters);
+    vector<int> next(grid.start.begin(), grid.start.end() - 1);
+    for (int j = 0; j < num_clusters; j++) {
+        grid.members[next[cell[j]]++] = j;
+    }
+
+}
+
+/*
+    Same selection as block_candidates, but reading only the grid cells within reach of the block. cota is the
+    squared maximum distance from the box to any one centroid (for instance the centroid of a cluster that already
+    holds points of the block): every centroid that can win inside the block is at most that far from the box, and
+    the selected set contains the one block_candidates selects, so the labels are the same as with the full scan
+*/
+void grid_candidates(const PointBlocks& blocks, long long int b, float** centroids, const CentroidGrid& grid, double cota, vector<int>& candidates) {
+
+    // Leaving the same slack as block_candidates, and turning the bound into a reach around the box
+    cota *= 1.0 + PRUNING_SLACK;
+    const double alcance = sqrt(cota) * (1.0 + PRUNING_SLACK);
+
+    // Range of cells within reach of the box
+    const int first_x = grid_cell(blocks.bounds[4 * b] - alcance, grid.min_x, grid.cell_w, grid.cells);
+    const int first_y = grid_cell(blocks.bounds[4 * b + 1] - alcance, grid.min_y, grid.cell_h, grid.cells);
+    const int last_x = grid_cell(blocks.bounds[4 * b + 2] + alcance, grid.min_x, grid.cell_w, grid.cells);
+    const int last_y = grid_cell(blocks.bounds[4 * b + 3] + alcance, grid.min_y, grid.cell_h, grid.cells);
+
+    // Keeping the centroids of those cells whose minimum distance to the box is within the bound
+    candidates.clear();
+    double min_distancia, max_distancia;
+    for (int cy = first_y; cy <= last_y; cy++) {
+        for (int cx = first_x; cx <= last_x; cx++) {
+            const int c = cy * grid.cells + cx;
+            for (int m = grid.start[c]; m < grid.start[c + 1]; m++) {
+                const int j = grid.members[m];
+                box_distances(blocks, b, centroids[j][0], centroids[j][1], min_distancia, max_distancia);
+                if (min_distancia <= cota) {
+                    candidates.push_back(j);
+                }
+            }
+        }
+    }
+
+    // Restoring increasing index order, so ties are resolved exactly as in the full scan
+    sort(candidates.begin(), candidates.end());
+
+}
+
+/* 
+    DEFINING Checkpoint FUNCTIONS
+*/
+
+// Identifier written at the start of every checkpoint file
+const unsigned int CHECKPOINT_MAGIC = 0x4B4D434B;
+
+// Fraction of the iteration time that the automatic checkpoint interval allows the snapshots to take
+const double CHECKPOINT_BUDGET = 0.01;
+
+/*
+    State of kmeans_paralelo after the assignment step of an iteration. The centroids of that iteration are enough
+    to rebuild the labels (the assignment is deterministic), so storing the labels is optional. layout identifies the
+    order of the point store (the space-filling curve used, if any), because the labels are stored in that order
+*/
+struct Checkpoint {
+    unsigned long long int seed = 0;
+    long long int size = 0;
+    int num_clusters = 0;
+    int layout = CURVE_NONE;
+    int iteration = 0;
+    bool converged = false;
+    vector<float> centroids;
+    vector<int> labels;
+};
+
+/*
+    Writing a checkpoint to file_name. The data goes to a temporary file that is renamed at the end, so an
+    interrupted write never replaces the previous checkpoint
+*/
+bool write_checkpoint(const string& file_name, const Checkpoint& state) {
+
+    // Opening the temporary file
+    const string temp_name = file_name + ".tmp";
+    ofstream out(temp_name, ios::binary);
+
+    // Checking if the file was successfully opened for writing
+    if (!out) {
+        cerr << "Couldn't write checkpoint: " << temp_name << "\n";
+        return false;
+    }
+
+    // Writing the header fields
+    const long long int num_labels = state.labels.size();
+    const char converged = state.converged;
+    out.write((const char*)&CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    out.write((const char*)&state.seed, sizeof(state.seed));
+    out.write((const char*)&state.size, sizeof(state.size));
+    out.write((const char*)&state.num_clusters, sizeof(state.num_clusters));
+    out.write((const char*)&state.layout, sizeof(state.layout));
+    out.write((const char*)&state.iteration, sizeof(state.iteration));
+    out.write(&converged, sizeof(converged));
+    out.write((const char*)&num_labels, sizeof(num_labels));
+
+    // Writing the centroids and, if present, the labels
+    out.write((const char*)state.centroids.data(), state.centroids.size() * sizeof(float));
+    out.write((const char*)state.labels.data(), num_labels * sizeof(int));
+
+    // Closing the file and checking that every write succeeded
+    out.close();
+    if (!out) {
+        cerr << "Couldn't write checkpoint: " << temp_name << "\n";
+        return false;
+    }
+
+    // Replacing the previous checkpoint
+    if (rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        cerr << "Couldn't replace checkpoint: " << file_name << "\n";
+        return false;
+    }
+
+    // Checkpoint written
+    return true;
+
+}
+
+/*
+    Reading a checkpoint written by write_checkpoint. size is the number of points of the current data set, which
+    bounds the number of clusters and of labels the file may declare, and max_iterations bounds its iteration counter
+*/
+bool load_checkpoint(const string& file_name, long long int size, int max_iterations, Checkpoint& state) {
+
+    // Opening the checkpoint file
+    ifstream in(file_name, ios::binary);
+
+    // Checking if the file was sucessfully opened
+    if (!in) {
+        cerr << "Couldn't read checkpoint: " << file_name << "\n";
+        return false;
+    }
+
+    // Reading and checking the file identifier
+    unsigned int magic = 0;
+    in.read((char*)&magic, sizeof(magic));
+    if (magic != CHECKPOINT_MAGIC) {
+        cerr << "Not a checkpoint file: " << file_name << "\n";
+        return false;
+    }
+
+    // Reading the header fields
+    long long int num_labels = 0;
+    char converged = 0;
+    in.read((char*)&state.seed, sizeof(state.seed));
+    in.read((char*)&state.size, sizeof(state.size));
+    in.read((char*)&state.num_clusters, sizeof(state.num_clusters));
+    in.read((char*)&state.layout, sizeof(state.layout));
+    in.read((char*)&state.iteration, sizeof(state.iteration));
+    in.read(&converged, sizeof(converged));
+    in.read((char*)&num_labels, sizeof(num_labels));
+    state.converged = converged;
+
+    // Checking the header before sizing anything from it, so a damaged file cannot request a huge allocation, and
+    // the iteration counter, which selects the random stream of every remaining iteration
+    if (!in || state.num_clusters <= 0 || state.num_clusters > size || num_labels < 0 || num_labels > size
+        || state.iteration < 0 || state.iteration > max_iterations) {
+        cerr << "Corrupt checkpoint: " << file_name << "\n";
+        return false;
+    }
+
+    // Reading the centroids and the labels
+    state.centroids.resize(2 * state.num_clusters);
+    state.labels.resize(num_labels);
+    in.read((char*)state.centroids.data(), state.centroids.size() * sizeof(float));
+    in.read((char*)state.labels.data(), num_labels * sizeof(int));
+
+    // Checking that the whole checkpoint was read
+    if (!in) {
+        cerr << "Truncated checkpoint: " << file_name << "\n";
+        return false;
+    }
+
+    // Checkpoint read
+    return true;
+
+}
+
+/*
+    Background writer of checkpoints. submit() only hands the state over to the writer thread, so the compute loop
+    never waits for the disk; if a write is still in progress, the pending state is replaced by the newer one
+*/
+class CheckpointWriter {
+
+public:
+
+    // Path of the checkpoint file, number of iterations between checkpoints (0 chooses it from the measured costs),
+    // whether labels are stored, and the layout of the point store
+    const string file_name;
+    const int every;
+    const bool with_labels;
+    const int layout;
+
+    // Time spent by the compute thread preparing and handing over checkpoints
+    double submit_time = 0.0;
+
+    // Starting the writer thread
+    CheckpointWriter(const string& file_name, int every, bool with_labels, int layout)
+        : file_name(file_name), every(every), with_labels(with_labels), layout(layout), writer(&CheckpointWriter::run, this) {}
+
+    // Writing the last pending state and stopping the writer thread
+    ~CheckpointWriter() {
+        {
+            lock_guard<mutex> lock(guard);
+            stop = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    // Whether iteration has to be checkpointed; the last iteration of a run always is
+    bool wants(int iteration, bool last) const {
+        return last || (every > 0 ? iteration % every == 0 : iteration >= next_iteration);
+    }
+
+    // Choosing the next automatic checkpoint from the cost of the snapshot just taken and the time of the iteration,
+    // so that the snapshots take at most CHECKPOINT_BUDGET of the compute time
+    void schedule(int iteration, double iteration_time, double snapshot_time) {
+        int interval = 1;
+        if (iteration_time > 0.0) {
+            interval = (int)min(1e6, max(1.0, ceil(snapshot_time / (CHECKPOINT_BUDGET * iteration_time))));
+        }
+        next_iteration = iteration + interval;
+    }
+
+    // Handing a state over to the writer thread
+    void submit(Checkpoint&& state) {
+        {
+            lock_guard<mutex> lock(guard);
+            pending = std::move(state);
+            has_pending = true;
+        }
+        wake.notify_one();
+    }
+
+private:
+
+    // First iteration of the next automatic checkpoint
+    int next_iteration = 0;
+
+    // Synchronization between the compute thread and the writer thread
+    mutex guard;
+    condition_variable wake;
+    Checkpoint pending;
+    bool has_pending = false;
+    bool stop = false;
+
+    // Writer thread, declared last so that it starts after the other members are initialized
+    thread writer;
+
+    // Loop of the writer thread: waiting for a state, writing it, and exiting once stopped with nothing pending
+    void run() {
+        unique_lock<mutex> lock(guard);
+        while (true) {
+            wake.wait(lock, [this] { return has_pending || stop; });
+            if (!has_pending) {
+                return;
+            }
+            Checkpoint state = std::move(pending);
+            has_pending = false;
+            lock.unlock();
+            write_checkpoint(file_name, state);
+            lock.lock();
+        }
+    }
+
+};
+
+/* 
+    IMPLEMENTING K_MEANS 
+*/
+
+/*
+    Index of the centroid closest to point in Euclidean distance. centroids[j] holds the x and y coordinates of
+    centroid j; only the num_candidates centroids listed in candidates are compared, or centroids 0 to
+    num_candidates - 1 when candidates is null. Every assignment of kmeans_paralelo (full scan, block scan, resume and
+    pipelined save) goes through this search, so they all produce the same labels
+*/
+inline int closest_centroid(const float* point, const float* const* centroids, const int* candidates, int num_candidates) {
+
+    // Initializing min_distance with infity to ensure thata any actual distance calculated will be smaller, helping to find the
+    // minimum distance to a centroid
+    float min_distancia = INFINITY;
+
+    // Initializing min_cluster -1, indicating that no cluster has been assigned yet
+    int min_cluster = -1;
+
+    // For loop iterating through the clusters
+    for (int c = 0; c < num_candidates; c++) {
+
+        // Index of the centroid being considered
+        const int j = (candidates != nullptr) ? candidates[c] : c;
+
+        // Calculating the difference in the x-coordinates between the point and the jth centroid
+        float distancia_x = point[0] - centroids[j][0];
+
+        // Calculating the difference in the y-coordinates between the point and the jth centroid
+        float distancia_y = point[1] - centroids[j][1];
+
+        // Calculating the euclidean distance
+        float distancia = sqrt(std::pow(distancia_x, 2) + std::pow(distancia_y, 2));
+
+        // Checking if the distance (distancia) from the current data point to the centroid being considered in this iteration is 
+        // less than the smallest distance found so far (min_distancia)
+        if (distancia < min_distancia) {
+
+            // Updating min_distance variable
+            min_distancia = distancia;
+
+            // Updating min_cluster to the index of this closer centroid
+            min_cluster = j;
+
+        }
+
+    }
+
+    // Returning the closest centroid
+    return min_cluster;
+
+}
+
+/** K-Means function
+ *  Performs the k-means algorithm in parallel to cluster data points into groups.
+ *  Array of data points where each row represents a point with "x", "y" coordinates and its cluster assignment
+ *  @param points  
+ *  Number of desired clusters
+ *  @param num_clusters 
+ *  Data set size (number of points).    
+ *  @param size
+ *  Maximum number of iterations allowed for the algorithm           
+ *  @param max_iterations 
+ *  Seed of the counter-based random numbers; the same seed gives the same result at any thread count
+ *  @param seed 
+ *  Optional bounding boxes of consecutive blocks of points (see reorder_points), used to prune centroids per block
+ *  @param blocks 
+ *  Optional background writer that receives a checkpoint after the assignment step of the selected iterations
+ *  @param checkpoint 
+ *  Optional checkpoint to continue from instead of starting with random labels
+ *  @param resume 
+ *  Optional per-cluster sums of the initial random labels, already set and accumulated while the points were loaded
+ *  @param initial_sums 
+ *  Optional original row of every stored point (see reorder_points); the random draws follow the original rows, so a
+ *  reordered store starts from the same labels and seeds as the file order
+ *  @param order 
+ *  Optional output for the centroids of the last allowed iteration; when given and the loop reaches max_iterations,
+ *  the assignment of that iteration is left to the caller (the pipelined save does it while writing)
+ *  @param final_centroids 
+ */
+
+void kmeans_paralelo(float** points, int num_clusters, long long int size, int max_iterations, unsigned long long int seed,
+                     const PointBlocks* blocks = nullptr, CheckpointWriter* checkpoint = nullptr, const Checkpoint* resume = nullptr,
+                     const ClusterSums* initial_sums = nullptr, const long long int* order = nullptr,
+                     vector<float>* final_centroids = nullptr) {
+
+    // Converge auxiliar variable that acts as a flag indicating whether the algorithm has converged - meaning that further do
+    // not siginifcatly change the outcome, usually defined as the cenroid of clusters no longer moving 
+    bool converge = false; 
+
+    // Integer auxuliar variable that counts the number if iterations the algorithm has performed.
+    int cuenta = 0;
+
+    // Stored position of every original row, needed to find the drawn seed points when the store is permuted
+    vector<long long int> inverse;
+    if (order != nullptr) {
+        invert_order(order, size, inverse);
+    }
+    const long long int* position = (order != nullptr) ? inverse.data() : nullptr;
+
+    // Checking if the run continues from a checkpoint
+    if (resume != nullptr) {
+
+        // Restoring the iteration counter and the convergence flag; the random streams are keyed by the iteration,
+        // so the remaining iterations draw the same numbers as an uninterrupted run
+        cuenta = resume->iteration;
+        converge = resume->converged;
+
+        // Checking if the labels were stored with the checkpoint
+        if (!resume->labels.empty()) {
+
+            // OpenMP Directive: restoring the label of every point
+            #pragma omp parallel for
+            for (long long int i = 0; i < size; i++) {
+                points[i][2] = resume->labels[i];
+            }
+
+        }
+        else {
+
+            // Rows of the stored centroids, in the form closest_centroid reads them
+            vector<const float*> filas(num_clusters);
+            for (int j = 0; j < num_clusters; j++) {
+                filas[j] = resume->centroids.data() + 2 * j;
+            }
+
+            // OpenMP Directive: rebuilding the labels with the same assignment the checkpointed iteration performed
+            #pragma omp parallel for
+            for (long long int i = 0; i < size; i++) {
+                points[i][2] = closest_centroid(points[i], filas.data(), nullptr, num_clusters);
+            }
+
+        }
+
+    }
+    // Checking if the initial labels still have to be drawn (the pipelined loader draws them while reading)
+    else if (initial_sums == nullptr) {
+
+        // OpenMP Directive:  instructs the compiler to parallelize the loop that follows. OpenMP automatically 
+        // divides the loop's iterations among the available threads, allowing the loop to execute much faster on multicore 
+        // processors
+        #pragma omp parallel for
+        //For loop to iterate over all data points
+        for (long long int i = 0; i < size; i++) {
+
+            // Assigning each points clustr assignment is determined by generating a random number, drawn from the
+            // counter (initial labels stream, original row) so that no generator state is shared between threads
+            points[i][2] = random_int(seed, STREAM_INITIAL_LABELS, (order != nullptr) ? order[i] : i, num_clusters); 
+                                          
+        }
+
+    }
+
+    // While loop that perfomr the iterative process of the algorithm       
+    while (!converge && cuenta < max_iterations) {
+
+        // Setting auxiliar converge variable on true 
+        converge = true;
+
+        // Incrementing to track the number of iterations the algorithm has performed
+        cuenta++;
+
+        // Starting time measurement of the iteration, used to choose the automatic checkpoint interval
+        double start_iteracion = omp_get_wtime();
+
+        // Dynamically allocating memory for centroids array, representing the coordinates of the centroids
+        float** centroids = new float*[num_clusters]; 
+
+        // Dynamically allocating memory for counts array, this is to keep track of the number of points assigned to each cluster
+        int* counts = new int[num_clusters];          
+
+        // Declaring a vector to store the indices of data points chosen as initial centroids
+        std::vector<int> centroid_indices;
+
+        // Number of random draws made for this iteration, used as the counter of the seeding stream
+        unsigned long long int draw = 0;
+
+        // While loop to iterate that is going to continue as lonsg as the number of slected indices is less than the deisreed number of clusters. This
+        // conditiion ensures that you select a unique index for each cluster
+        while (centroid_indices.size() < num_clusters) {
+
+            // Generating a random index from the seeding stream of this iteration
+            int index = random_int(seed, STREAM_CENTROID_SEEDING + cuenta, draw++, num_clusters); 
+
+            // Checcking uniqueness
+            if (std::find(centroid_indices.begin(), centroid_indices.end(), index) == centroid_indices.end()) {
+
+                // Adding the unique index
+                centroid_indices.push_back(index);
+
+            }
+
+        }
+
+        // For loop to iterate over the numbr of clusters
+        for (int i = 0; i < num_clusters; i++) {
+
+            // For each cluster, this line isdynamically allocates memory for an array of two float values, which represent the x and y coordinates of the centroid
+            // (the drawn index is an original row)
+            float* semilla = points[(position != nullptr) ? position[centroid_indices[i]] : centroid_indices[i]];
+            centroids[i] = new float[2]{semilla[0], semilla[1]};
+
+            // Initializing the count of data associated with the ith cluster to 0
+            counts[i] = 0;
+
+        }
+
+        // Summing the coordinates and counting the points of every cluster. cluster_sums combines fixed blocks of
+        // points in block order, so unlike atomic additions the floating-point result does not depend on how the
+        // threads interleave
+        vector<double> sums, totals;
+
+        // The sums of the initial labels may have been accumulated already, with the same blocks, while loading
+        if (cuenta == 1 && initial_sums != nullptr) {
+            sums = initial_sums->sums;
+            totals = initial_sums->totals;
+        }
+        else {
+            cluster_sums(size, num_clusters, [&](long long int i, int& cluster, double& x, double& y, double& w) {
+                cluster = (int)points[i][2];
+                x = points[i][0];
+                y = points[i][1];
+                w = 1.0;
+            }, sums, totals);
+        }
+
+        // For loop adding the sums to the centroids and storing the counts
+        for (int i = 0; i < num_clusters; i++) {
+
+            // Updating centroid coordindates (x-coordinate and y-coordinate)
+            centroids[i][0] += sums[2 * i];
+            centroids[i][1] += sums[2 * i + 1];
+
+            // Storing the number of points assigned to the cluster
+            counts[i] = (int)totals[i];
+
+        }
+
+        // For loop to iterate over each cluster
+        for (int i = 0; i < num_clusters; i++) {
+
+            // If the current cluster has one or more assigned points (counts[i] > 0), the coordinates of its centroid are updated
+            if (counts[i] > 0) {
+
+                // Updating centroid coordindates (x-coordinate)
+                centroids[i][0] /= counts[i];
+
+                // Updating centroid coordindates (y-coordinate) 
+                centroids[i][1] /= counts[i];
+
+            }
+
+        }
+
+        // Checking if this is the last allowed iteration and its assignment is known to be the final one, in which
+        // case it is handed to the caller instead of being done here
+        const bool diferida = final_centroids != nullptr && cuenta == max_iterations;
+        if (diferida) {
+
+            // Returning the centroids of the iteration
+            final_centroids->resize(2 * num_clusters);
+            for (int j = 0; j < num_clusters; j++) {
+                (*final_centroids)[2 * j] = centroids[j][0];
+                (*final_centroids)[2 * j + 1] = centroids[j][1];
+            }
+
+        }
+        // Checking if the points carry block bounding boxes, in which case the assignment is done block by block
+        else if (blocks != nullptr) {
+
+            // OpenMP Directive: each thread keeps one candidate list for all the blocks it assigns
+            #pragma omp parallel reduction(&& : converge)
+            {
+                vector<int> candidates;
+
+                // OpenMP Directive: each block is assigned by one thread; dynamic scheduling balances blocks that keep
+                // different numbers of candidate centroids
+                #pragma omp for schedule(dynamic)
+                // For loop over the blocks
+                for (long long int b = 0; b < blocks->num_blocks; b++) {
+
+                    // Selecting the centroids that can be the nearest one for some point of the block
+                    block_candidates(*blocks, b, centroids, num_clusters, candidates);
+
+                    // Range of points that belong to the block
+                    long long int first = b * blocks->block_size;
+                    long long int last = min(first + blocks->block_size, size);
+
+                    // For loop over the points of the block
+                    for (long long int i = first; i < last; i++) {
+
+                        // Same search as in the full scan below, restricted to the candidate centroids
+                        int min_cluster = closest_centroid(points[i], centroids, candidates.data(), candidates.size());
+
+                        // Updating the cluster assignment and indicating non-convergence if it changed
+                        if (min_cluster != points[i][2]) {
+                            points[i][2] = min_cluster;
+                            converge = false;
+                        }
+
+                    }
+
+                }
+            }
+
+        }
+        else {
+
+            // OpenMP Directive:  instructs the compiler to parallelize the loop that follows. OpenMP automatically 
+            // divides the loop's iterations among the available threads, allowing the loop to execute much faster on multicore 
+            // processors. The reduction(&& : converge) clause is used for the converge variable, a boolean flag indicating whether the 
+            // algorithm has converged (i.e., if there were no changes in cluster assignments in this iteration)
+            #pragma omp parallel for reduction(&& : converge)
+            // For loop to iterate all over the points
+            for (long long int i = 0; i < size; i++) {
+
+                // Finding the centroid nearest to the ith data point among all the clusters
+                int min_cluster = closest_centroid(points[i], centroids, nullptr, num_clusters);
+
+                // Checking if the nearest cluster (min_cluster) identified for the i-th data point is different from the data point's current cluster 
+                // assignment (points[i][2])
+                if (min_cluster != points[i][2]) {
+
+                    // Updating cluster assignment
+                    points[i][2] = min_cluster;
+
+                    // Indicating non-convergence
+                    converge = false;
+
+                }
+
+            }
+
+        }
+
+        // Checking if this iteration has to be checkpointed
+        if (checkpoint != nullptr && checkpoint->wants(cuenta, converge || cuenta == max_iterations)) {
+
+            // Starting time measurement of the checkpoint hand-over
+            double start_checkpoint = omp_get_wtime();
+
+            // Taking a snapshot of the state; the writer thread copies nothing from the live arrays
+            Checkpoint estado;
+            estado.seed = seed;
+            estado.size = size;
+            estado.num_clusters = num_clusters;
+            estado.layout = checkpoint->layout;
+            estado.iteration = cuenta;
+            estado.converged = converge && !diferida;
+            estado.centroids.resize(2 * num_clusters);
+            for (int j = 0; j < num_clusters; j++) {
+                estado.centroids[2 * j] = centroids[j][0];
+                estado.centroids[2 * j + 1] = centroids[j][1];
+            }
+
+            // Gathering the labels, if requested; a deferred assignment has no labels yet, and a resume rebuilds them
+            // from the centroids
+            if (checkpoint->with_labels && !diferida) {
+                estado.labels.resize(size);
+
+                // OpenMP Directive: every label is copied independently
+                #pragma omp parallel for
+                for (long long int i = 0; i < size; i++) {
+                    estado.labels[i] = (int)points[i][2];
+                }
+            }
+
+            // Handing the snapshot over to the writer thread
+            checkpoint->submit(std::move(estado));
+
+            // Accumulating the time the compute loop spent on the checkpoint
+            double end_checkpoint = omp_get_wtime();
+            checkpoint->submit_time += end_checkpoint - start_checkpoint;
+
+            // Scheduling the next checkpoint from the measured costs
+            checkpoint->schedule(cuenta, start_checkpoint - start_iteracion, end_checkpoint - start_checkpoint);
+
+        }
+
+        // For loop to iterate over eacj¡h centroid
+        for (int i = 0; i < num_clusters; i++) {
+
+            // Deallocating memory for each array of centroids coordinates
+            delete[] centroids[i];
+
+        }
+
+        // Deallocating the memory assigned fot the centroids array
+        delete[] centroids;
+
+        // Deallocating the memory assigned for the counts array
+        delete[] counts;
+
+    }
+
+}
+
+/* 
+    IMPLEMENTING CORESET K_MEANS 
+*/
+
+// Number of lines read from the file before they are reduced into the streaming coreset
+const long long int CORESET_CHUNK = 65536;
+
+/*
+    Weighted set of points. The coordinates are stored as x, y pairs and weights[i] is the number of input points
+    that the ith point of the set stands for
+*/
+struct Coreset {
+    vector<float> coords;
+    vector<double> weights;
+};
+
+/*
+    Coresets of the chunks read so far, combined as in a binary counter: levels[l] is either empty or summarizes
+    2^l chunks, so every input point goes through at most log2(number of chunks) + 1 reductions. Each reduction draws
+    from its own random stream, numbered by the reductions counter
+*/
+struct StreamingCoreset {
+    long long int coreset_size = 0;
+    unsigned long long int seed = 0;
+    unsigned long long int reductions = 0;
+    vector<Coreset> levels;
+};
+
+/*
+    Drawing an index with probability proportional to its mass, given the inclusive prefix sums of the masses and a
+    uniform number u in [0, total mass)
+*/
+long long int sample_index(const vector<double>& cumulative, double u) {
+
+    // Finding the first prefix sum that exceeds u
+    long long int index = std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+
+    // Guarding against u rounding up to the total mass
+    return min(index, (long long int)cumulative.size() - 1);
+
+}
+
+/*
+    Reducing a weighted set to coreset_size points by sensitivity sampling. Each point is sampled with probability
+    q = 1/2 * w / W + 1/2 * w * d^2 / sum(w * d^2), where d is its distance to the weighted mean, and a sampled point
+    receives weight w / (coreset_size * q), so the weighted cost of any set of centroids is preserved in expectation.
+    The samples are drawn from the given random stream
+*/
+void coreset_reduce(const Coreset& input, long long int coreset_size, unsigned long long int seed, unsigned long long int stream, Coreset& output) {
+
+    // Number of weighted points in the input
+    const long long int n = input.weights.size();
+
+    // Nothing to reduce when the input is already small enough
+    if (n <= coreset_size) {
+        output = input;
+        return;
+    }
+
+    // Computing the total weight and the weighted mean of the input
+    const double total_weight = block_sum(n, [&](long long int i) { return input.weights[i]; });
+    const double mean_x = block_sum(n, [&](long long int i) { return input.weights[i] * input.coords[2 * i]; }) / total_weight;
+    const double mean_y = block_sum(n, [&](long long int i) { return input.weights[i] * input.coords[2 * i + 1]; }) / total_weight;
+
+    // Weighted squared distance of each point to the mean
+    vector<double> probabilities(n);
+
+    // OpenMP Directive: every distance depends only on its own point
+    #pragma omp parallel for
+    for (long long int i = 0; i < n; i++) {
+        double dx = input.coords[2 * i] - mean_x;
+        double dy = input.coords[2 * i + 1] - mean_y;
+        probabilities[i] = input.weights[i] * (dx * dx + dy * dy);
+    }
+
+    // Sum of the weighted squared distances
+    const double total_cost = block_sum(n, [&](long long int i) { return probabilities[i]; });
+
+    // OpenMP Directive: turning the costs into sampling probabilities (uniform by weight if all points coincide)
+    #pragma omp parallel for
+    for (long long int i = 0; i < n; i++) {
+        double uniforme = input.weights[i] / total_weight;
+        probabilities[i] = 0.5 * uniforme + ((total_cost > 0.0) ? 0.5 * probabilities[i] / total_cost : 0.5 * uniforme);
+    }
+
+    // Prefix sums of the probabilities, used to draw the samples
+    vector<double> cumulative = probabilities;
+    parallel_prefix_sum(cumulative);
+
+    // Allocating the reduced set
+    output.coords.resize(2 * coreset_size);
+    output.weights.resize(coreset_size);
+
+    // OpenMP Directive: the samples are drawn, located and weighted independently; sample s uses draw s of the stream
+    #pragma omp parallel for
+    for (long long int s = 0; s < coreset_size; s++) {
+        long long int index = sample_index(cumulative, random_uniform(seed, stream, s) * cumulative.back());
+        output.coords[2 * s] = input.coords[2 * index];
+        output.coords[2 * s + 1] = input.coords[2 * index + 1];
+        output.weights[s] = input.weights[index] / (coreset_size * probabilities[index]);
+    }
+
+}
+
+/*
+    Merging two coresets: the union of coresets of disjoint inputs is a coreset of the union of the inputs
+*/
+void coreset_union(Coreset& into, const Coreset& other) {
+    into.coords.insert(into.coords.end(), other.coords.begin(), other.coords.end());
+    into.weights.insert(into.weights.end(), other.weights.begin(), other.weights.end());
+}
+
+/*
+    Adding the coreset of a new chunk to the stream, merging and reducing full levels like a binary counter carry
+*/
+void coreset_insert(StreamingCoreset& stream, Coreset chunk) {
+
+    // Reducing the chunk itself to the coreset size
+    Coreset carry;
+    coreset_reduce(chunk, stream.coreset_size, stream.seed, STREAM_CORESET_SAMPLING + stream.reductions++, carry);
+
+    // Walking up the levels while they are occupied
+    size_t level = 0;
+    while (level < stream.levels.size() && !stream.levels[level].weights.empty()) {
+
+        // Merging the carried coreset with the one stored at this level and reducing the result
+        coreset_union(carry, stream.levels[level]);
+        Coreset reduced;
+        coreset_reduce(carry, stream.coreset_size, stream.seed, STREAM_CORESET_SAMPLING + stream.reductions++, reduced);
+        carry = std::move(reduced);
+
+        // The level is now empty and the carry moves one level up
+        stream.levels[level] = Coreset();
+        level++;
+
+    }
+
+    // Storing the carry at the first free level
+    if (level == stream.levels.size()) {
+        stream.levels.push_back(Coreset());
+    }
+    stream.levels[level] = std::move(carry);
+
+}
+
+/*
+    Merging every level of the stream into the final coreset of coreset_size points
+*/
+void coreset_finish(StreamingCoreset& stream, Coreset& coreset) {
+
+    // Union of all the stored levels
+    Coreset all;
+    for (const Coreset& level : stream.levels) {
+        coreset_union(all, level);
+    }
+
+    // Final reduction
+    coreset_reduce(all, stream.coreset_size, stream.seed, STREAM_CORESET_SAMPLING + stream.reductions++, coreset);
+
+}
+
+/*
+    Reading data from a CSV file in chunks of CORESET_CHUNK lines. Every chunk is parsed in parallel into the point
+    store and folded into the streaming coreset, so the coreset is ready when the single read of the file ends.
+    build_time receives the time spent building the coreset, apart from reading and parsing
+*/
+void load_CSV_coreset(string file_name, float** points, long long int size, long long int coreset_size, unsigned long long int seed, Coreset& coreset, double& build_time) {
+
+    // No construction time until a chunk is folded
+    build_time = 0.0;
+
+    // Opening the CSV file
+    ifstream in(file_name);
+
+    // Checking if the file was sucessfully opened
+    if (!in) {
+
+        // Priting message of unsucessful open file
+        cerr << "Couldn't read file: " << file_name << "\n";
+
+        // Exit the function
+        return;
+
+    }
+
+    // Initializing the stream of chunk coresets
+    StreamingCoreset stream;
+    stream.coreset_size = coreset_size;
+    stream.seed = seed;
+
+    // Number of points read so far
+    long long int point_number = 0;
+
+    // Lines of the current chunk
+    vector<string> lines;
+    string line;
+
+    // While loop over the chunks of the file
+    while (point_number < size) {
+
+        // Reading the lines of the chunk
+        lines.clear();
+        while ((long long int)lines.size() < CORESET_CHUNK && point_number + (long long int)lines.size() < size && getline(in, line)) {
+            lines.push_back(line);
+        }
+
+        // Stopping at the end of the file
+        if (lines.empty()) {
+            break;
+        }
+
+        // The chunk enters the stream as a set of points of weight one
+        const long long int n = lines.size();
+        Coreset chunk;
+        chunk.coords.resize(2 * n);
+        chunk.weights.assign(n, 1.0);
+
+        // OpenMP Directive: the lines of the chunk are parsed independently
+        #pragma omp parallel for
+        for (long long int i = 0; i < n; i++) {
+            parse_line(lines[i], points[point_number + i]);
+            chunk.coords[2 * i] = points[point_number + i][0];
+            chunk.coords[2 * i + 1] = points[point_number + i][1];
+        }
+
+        // Folding the chunk into the streaming coreset
+        double start_build = omp_get_wtime();
+        coreset_insert(stream, std::move(chunk));
+        build_time += omp_get_wtime() - start_build;
+
+        // Advancing to the next chunk
+        point_number += n;
+
+    }
+
+    // Closing the file after reading all necessary data
+    in.close();
+
+    // Building the final coreset
+    double start_build = omp_get_wtime();
+    coreset_finish(stream, coreset);
+    build_time += omp_get_wtime() - start_build;
+
+}
+
+/*
+    Index of the centroid closest to (x, y); centroids holds num_clusters x, y pairs
+*/
+int nearest_centroid(float x, float y, const vector<float>& centroids, int num_clusters) {
+
+    // Initializing the search with an infinite distance and no cluster
+    float min_distancia = INFINITY;
+    int min_cluster = -1;
+
+    // For loop over the centroids, comparing squared distances
+    for (int j = 0; j < num_clusters; j++) {
+        float distancia_x = x - centroids[2 * j];
+        float distancia_y = y - centroids[2 * j + 1];
+        float distancia = distancia_x * distancia_x + distancia_y * distancia_y;
+        if (distancia < min_distancia) {
+            min_distancia = distancia;
+            min_cluster = j;
+        }
+    }
+
+    // Returning the closest centroid
+    return min_cluster;
+
+}
+
+/** Weighted K-Means function
+ *  Clusters a weighted set of points with k-means++ seeding followed by weighted Lloyd iterations.
+ *  Weighted set of points to cluster
+ *  @param coreset  
+ *  Number of desired clusters
+ *  @param num_clusters 
+ *  Maximum number of iterations allowed for the algorithm           
+ *  @param max_iterations 
+ *  Seed of the random draws of the k-means++ seeding (draw c of the k-means++ stream chooses centroid c)
+ *  @param seed 
+ *  Output: num_clusters x, y pairs with the final centroids
+ *  @param centroids 
+ */
+
+void kmeans_ponderado(const Coreset& coreset, int num_clusters, int max_iterations, unsigned long long int seed, vector<float>& centroids) {
+
+    // Number of weighted points
+    const long long int n = coreset.weights.size();
+
+    // Allocating the centroids
+    centroids.assign(2 * num_clusters, 0.0f);
+
+    // Without weighted points (the file could not be read) there is nothing to seed from, and the centroids stay at
+    // the origin
+    if (n == 0) {
+        return;
+    }
+
+    // Squared distance of each point to its closest chosen centroid
+    vector<double> min_distancias(n, INFINITY);
+
+    // Mass of each point in the k-means++ draw
+    vector<double> cumulative(n);
+
+    // For loop choosing the centroids one by one (k-means++)
+    for (int c = 0; c < num_clusters; c++) {
+
+        // OpenMP Directive: the first centroid is drawn by weight, the next ones by weight times squared distance
+        #pragma omp parallel for
+        for (long long int i = 0; i < n; i++) {
+            cumulative[i] = (c == 0) ? coreset.weights[i] : coreset.weights[i] * min_distancias[i];
+        }
+        parallel_prefix_sum(cumulative);
+
+        // Falling back to a draw by weight when every point already coincides with a centroid
+        if (!(cumulative.back() > 0.0)) {
+            for (long long int i = 0; i < n; i++) {
+                cumulative[i] = coreset.weights[i] + ((i > 0) ? cumulative[i - 1] : 0.0);
+            }
+        }
+
+        // Drawing the new centroid
+        long long int index = sample_index(cumulative, random_uniform(seed, STREAM_KMEANSPP, c) * cumulative.back());
+        centroids[2 * c] = coreset.coords[2 * index];
+        centroids[2 * c + 1] = coreset.coords[2 * index + 1];
+
+        // OpenMP Directive: updating the distance of every point to its closest chosen centroid
+        #pragma omp parallel for
+        for (long long int i = 0; i < n; i++) {
+            double dx = coreset.coords[2 * i] - centroids[2 * c];
+            double dy = coreset.coords[2 * i + 1] - centroids[2 * c + 1];
+            min_distancias[i] = min(min_distancias[i], dx * dx + dy * dy);
+        }
+
+    }
+
+    // Current cluster of each weighted point
+    vector<int> labels(n, -1);
+
+    // Weighted coordinate sums and total weight of each cluster
+    vector<double> sums, totals;
+
+    // Convergence flag and iteration counter, as in kmeans_paralelo
+    bool converge = false;
+    int cuenta = 0;
+
+    // While loop that performs the weighted Lloyd iterations
+    while (!converge && cuenta < max_iterations) {
+
+        // Setting auxiliar converge variable on true 
+        converge = true;
+
+        // Incrementing to track the number of iterations the algorithm has performed
+        cuenta++;
+
+        // OpenMP Directive: assigning every weighted point to its closest centroid
+        #pragma omp parallel for reduction(&& : converge)
+        for (long long int i = 0; i < n; i++) {
+            int min_cluster = nearest_centroid(coreset.coords[2 * i], coreset.coords[2 * i + 1], centroids, num_clusters);
+            if (min_cluster != labels[i]) {
+                labels[i] = min_cluster;
+                converge = false;
+            }
+        }
+
+        // Accumulating the weighted sums of every cluster in a fixed block order
+        cluster_sums(n, num_clusters, [&](long long int i, int& cluster, double& x, double& y, double& w) {
+            cluster = labels[i];
+            x = coreset.coords[2 * i];
+            y = coreset.coords[2 * i + 1];
+            w = coreset.weights[i];
+        }, sums, totals);
+
+        // Moving each non-empty cluster centroid to the weighted mean of its points
+        for (int j = 0; j < num_clusters; j++) {
+            if (totals[j] > 0.0) {
+                centroids[2 * j] = sums[2 * j] / totals[j];
+                centroids[2 * j + 1] = sums[2 * j + 1] / totals[j];
+            }
+        }
+
+    }
+
+}
+
+/*
+    Assigning every point of the full data set to its closest centroid
+*/
+void assign_points(float** points, long long int size, const vector<float>& centroids, int num_clusters) {
+
+    // OpenMP Directive: every point is assigned independently
+    #pragma omp parallel for
+    for (long long int i = 0; i < size; i++) {
+        points[i][2] = nearest_centroid(points[i][0], points[i][1], centroids, num_clusters);
+    }
+
+}
+
+/*
+    Inertia of a clustering: sum of the squared distances from every point to the mean of its cluster
+*/
+double compute_inertia(float** points, long long int size, int num_clusters) {
+
+    // Coordinate sums and number of points of every cluster, accumulated in a fixed block order (points without a
+    // cluster count with weight zero)
+    vector<double> sums, counts;
+    cluster_sums(size, num_clusters, [&](long long int i, int& cluster, double& x, double& y, double& w) {
+        cluster = max(0, (int)points[i][2]);
+        x = points[i][0];
+        y = points[i][1];
+        w = (points[i][2] >= 0) ? 1.0 : 0.0;
+    }, sums, counts);
+
+    // Turning the sums into means
+    for (int j = 0; j < num_clusters; j++) {
+        if (counts[j] > 0.0) {
+            sums[2 * j] /= counts[j];
+            sums[2 * j + 1] /= counts[j];
+        }
+    }
+
+    // Sum of the squared distances to the means, also added in a fixed block order
+    return block_sum(size, [&](long long int i) {
+        int cluster = (int)points[i][2];
+        if (cluster < 0) {
+            return 0.0;
+        }
+        double dx = points[i][0] - sums[2 * cluster];
+        double dy = points[i][1] - sums[2 * cluster + 1];
+        return dx * dx + dy * dy;
+    });
+
+}
+
+/* 
+    IMPLEMENTING HIERARCHICAL K_MEANS 
+*/
+
+// Maximum number of 2-means iterations used to split one cluster
+const int SPLIT_ITERATIONS = 10;
+
+/*
+    Splitting the slice [first, last) of the point store in two with 2-means. The first centroid is a random point
+    and the second is drawn with probability proportional to the squared distance to the first (k-means++). On
+    return the points of the first cluster are stored in [first, first + n_left) and the rest after them, keeping
+    their relative order, and order is permuted alongside. Returns n_left, or -1 when all points coincide
+*/
+long long int bisect_slice(float** points, long long int first, long long int last, long long int* order,
+                           unsigned long long int seed, unsigned long long int stream, unsigned long long int draw) {
+
+    // Number of points and of reduction blocks of the slice
+    const long long int n = last - first;
+    const long long int num_blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+
+    // Partial results of every block: squared distances, then 2-means sums, then point counts
+    vector<double> partial_store(6 * num_blocks);
+    vector<char> changed_store(num_blocks);
+    vector<long long int> left_store(num_blocks + 1);
+    double* partial = partial_store.data();
+    char* changed = changed_store.data();
+    long long int* left = left_store.data();
+
+    // Choosing the first centroid uniformly among the points of the slice
+    const long long int index0 = first + min(n - 1, (long long int)(random_uniform(seed, stream, draw) * n));
+    float c[4] = {points[index0][0], points[index0][1], 0.0f, 0.0f};
+
+    // OpenMP Directive: squared distance of every block to the first centroid, one task per block
+    #pragma omp taskloop grainsize(1) if(num_blocks > 1)
+    for (long long int b = 0; b < num_blocks; b++) {
+        partial[b] = 0.0;
+        for (long long int i = first + b * REDUCTION_BLOCK; i < min(last, first + (b + 1) * REDUCTION_BLOCK); i++) {
+            double dx = points[i][0] - c[0];
+            double dy = points[i][1] - c[1];
+            partial[b] += dx * dx + dy * dy;
+        }
+    }
+
+    // Adding the block distances in block order
+    double total = 0.0;
+    for (long long int b = 0; b < num_blocks; b++) {
+        total += partial[b];
+    }
+
+    // Every point coincides with the first centroid, so the slice cannot be split by distance
+    if (!(total > 0.0)) {
+        return -1;
+    }
+
+    // Drawing the second centroid with probability proportional to the squared distance
+    double u = random_uniform(seed, stream, draw + 1) * total;
+    long long int b1 = 0;
+    while (b1 < num_blocks - 1 && u >= partial[b1]) {
+        u -= partial[b1];
+        b1++;
+    }
+    long long int index1 = first + b1 * REDUCTION_BLOCK;
+    for (long long int i = index1; i < min(last, first + (b1 + 1) * REDUCTION_BLOCK); i++) {
+        double dx = points[i][0] - c[0];
+        double dy = points[i][1] - c[1];
+        index1 = i;
+        u -= dx * dx + dy * dy;
+        if (u < 0.0 && dx * dx + dy * dy > 0.0) {
+            break;
+        }
+    }
+    c[2] = points[index1][0];
+    c[3] = points[index1][1];
+
+    // For loop over the 2-means iterations
+    for (int iteration = 0; iteration < SPLIT_ITERATIONS; iteration++) {
+
+        // OpenMP Directive: assigning the points of every block to the closest of the two centroids (the side is kept
+        // in the label column) and accumulating the block sums, one task per block
+        #pragma omp taskloop grainsize(1) if(num_blocks > 1)
+        for (long long int b = 0; b < num_blocks; b++) {
+            double* block = partial + 6 * b;
+            block[0] = block[1] = block[2] = block[3] = block[4] = block[5] = 0.0;
+            changed[b] = 0;
+            for (long long int i = first + b * REDUCTION_BLOCK; i < min(last, first + (b + 1) * REDUCTION_BLOCK); i++) {
+                float d0 = (points[i][0] - c[0]) * (points[i][0] - c[0]) + (points[i][1] - c[1]) * (points[i][1] - c[1]);
+                float d1 = (points[i][0] - c[2]) * (points[i][0] - c[2]) + (points[i][1] - c[3]) * (points[i][1] - c[3]);
+                int side = (d1 < d0) ? 1 : 0;
+                if (iteration == 0 || points[i][2] != side) {
+                    changed[b] = 1;
+                }
+                points[i][2] = side;
+                block[2 * side] += points[i][0];
+                block[2 * side + 1] += points[i][1];
+                block[4 + side] += 1.0;
+            }
+        }
+
+        // Combining the block sums in block order and checking whether any point changed side
+        double sums[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        bool converge = true;
+        for (long long int b = 0; b < num_blocks; b++) {
+            for (int v = 0; v < 6; v++) {
+                sums[v] += partial[6 * b + v];
+            }
+            converge = converge && !changed[b];
+        }
+
+        // Stopping once the split is stable
+        if (converge) {
+            break;
+        }
+
+        // Moving each non-empty side to the mean of its points
+        for (int side = 0; side < 2; side++) {
+            if (sums[4 + side] > 0.0) {
+                c[2 * side] = sums[2 * side] / sums[4 + side];
+                c[2 * side + 1] = sums[2 * side + 1] / sums[4 + side];
+            }
+        }
+
+    }
+
+    // OpenMP Directive: counting the points of the first side in every block
+    #pragma omp taskloop grainsize(1) if(num_blocks > 1)
+    for (long long int b = 0; b < num_blocks; b++) {
+        left[b + 1] = 0;
+        for (long long int i = first + b * REDUCTION_BLOCK; i < min(last, first + (b + 1) * REDUCTION_BLOCK); i++) {
+            left[b + 1] += (points[i][2] == 0);
+        }
+    }
+
+    // Turning the counts into the position of every block inside the first side
+    left[0] = 0;
+    for (long long int b = 0; b < num_blocks; b++) {
+        left[b + 1] += left[b];
+    }
+    const long long int n_left = left[num_blocks];
+
+    // Temporary copies of the partitioned slice
+    vector<float> moved_store(3 * n);
+    vector<long long int> moved_order_store(n);
+    float* moved = moved_store.data();
+    long long int* moved_order = moved_order_store.data();
+
+    // OpenMP Directive: scattering every block to its positions in the two sides, one task per block
+    #pragma omp taskloop grainsize(1) if(num_blocks > 1)
+    for (long long int b = 0; b < num_blocks; b++) {
+        long long int to_left = left[b];
+        long long int to_right = n_left + (b * REDUCTION_BLOCK - left[b]);
+        for (long long int i = first + b * REDUCTION_BLOCK; i < min(last, first + (b + 1) * REDUCTION_BLOCK); i++) {
+            long long int to = (points[i][2] == 0) ? to_left++ : to_right++;
+            moved[3 * to] = points[i][0];
+            moved[3 * to + 1] = points[i][1];
+            moved[3 * to + 2] = points[i][2];
+            moved_order[to] = order[i];
+        }
+    }
+
+    // OpenMP Directive: copying the partitioned slice back into the point store
+    #pragma omp taskloop grainsize(REDUCTION_BLOCK) if(num_blocks > 1)
+    for (long long int i = 0; i < n; i++) {
+        points[first + i][0] = moved[3 * i];
+        points[first + i][1] = moved[3 * i + 1];
+        points[first + i][2] = moved[3 * i + 2];
+        order[first + i] = moved_order[i];
+    }
+
+    // Returning the size of the first side
+    return n_left;
+
+}
+
+/*
+    Splitting the slice [first, last) into num_clusters clusters labeled base, ..., base + num_clusters - 1. The slice
+    is bisected, the clusters are divided between the two halves in proportion to their sizes, and each half is
+    solved by its own task, so sibling subproblems run in parallel on disjoint contiguous slices
+*/
+void bisect_recursive(float** points, long long int first, long long int last, int num_clusters, int base,
+                      long long int* order, unsigned long long int seed) {
+
+    // Number of points of the slice
+    const long long int n = last - first;
+
+    // A single cluster: labeling every point of the slice with it
+    if (num_clusters == 1) {
+
+        // OpenMP Directive: labeling large slices with several tasks
+        #pragma omp taskloop grainsize(REDUCTION_BLOCK) if(n > REDUCTION_BLOCK)
+        for (long long int i = first; i < last; i++) {
+            points[i][2] = base;
+        }
+
+        // Slice done
+        return;
+
+    }
+
+    // Splitting the slice; the random draws of the node come from the stream of its first label and are numbered by
+    // its number of clusters, so every node of the tree has its own draws
+    long long int n_left = bisect_slice(points, first, last, order, seed, STREAM_HIERARCHICAL + base, (unsigned long long int)num_clusters << 32);
+
+    // When all points coincide, or 2-means leaves one side empty, the slice is split in halves
+    if (n_left <= 0 || n_left >= n) {
+        n_left = n / 2;
+    }
+
+    // Dividing the clusters in proportion to the sizes of the two halves, with at least one cluster per half and no
+    // more clusters than points in either half
+    int k_left = (int)llround((double)num_clusters * n_left / n);
+    k_left = max(k_left, 1);
+    k_left = min(k_left, num_clusters - 1);
+    k_left = (int)min((long long int)k_left, n_left);
+    k_left = (int)max((long long int)k_left, num_clusters - (n - n_left));
+
+    // OpenMP Directive: solving the first half in its own task
+    #pragma omp task
+    bisect_recursive(points, first, first + n_left, k_left, base, order, seed);
+
+    // OpenMP Directive: solving the second half in its own task
+    #pragma omp task
+    bisect_recursive(points, first + n_left, last, num_clusters - k_left, base + k_left, order, seed);
+
+}
+
+/** Hierarchical K-Means function
+ *  Builds num_clusters clusters by recursive 2-means bisection. Every level of the tree touches each point once with
+ *  two centroids, so the assignment cost is O(N log k) instead of the O(N k) of a flat iteration. The point store is
+ *  permuted so that every cluster ends up in a contiguous slice.
+ *  Array of data points where each row represents a point with "x", "y" coordinates and its cluster assignment
+ *  @param points  
+ *  Number of desired clusters (at most size)
+ *  @param num_clusters 
+ *  Data set size (number of points).    
+ *  @param size
+ *  Seed of the counter-based random numbers
+ *  @param seed 
+ *  Original row of each stored point, permuted together with the points
+ *  @param order 
+ */
+
+void kmeans_jerarquico(float** points, int num_clusters, long long int size, unsigned long long int seed, vector<long long int>& order) {
+
+    // Raw pointer to the permutation, shared by all the tasks
+    long long int* order_data = order.data();
+
+    // OpenMP Directive: one thread starts the recursion and the team runs the tasks it creates
+    #pragma omp parallel
+    #pragma omp single
+    bisect_recursive(points, 0, size, num_clusters, 0, order_data, seed);
+
+}
+
+/*
+    Flat Lloyd refinement of the current labels, for at most iterations iterations. The assignment uses the block
+    bounding boxes to skip the centroids that cannot be the closest one for any point of a block. Every cluster is a
+    contiguous slice after the bisection, so a block holds points of only a few clusters: their centroids bound the
+    distance to the winner, and a grid over the centroids finds the few others within that distance, instead of
+    comparing every block against all the centroids
+*/
+void refine_lloyd(float** points, long long int size, int num_clusters, int iterations, const PointBlocks& blocks) {
+
+    // Centroids, stored contiguously and viewed as rows for grid_candidates
+    vector<float> centroid_store(2 * num_clusters, 0.0f);
+    vector<float*> centroid_rows(num_clusters);
+    for (int j = 0; j < num_clusters; j++) {
+        centroid_rows[j] = centroid_store.data() + 2 * j;
+    }
+    float** centroids = centroid_rows.data();
+
+    // For loop over the refinement iterations
+    for (int iteration = 0; iteration < iterations; iteration++) {
+
+        // Moving every non-empty cluster centroid to the mean of its points
+        vector<double> sums, totals;
+        cluster_sums(size, num_clusters, [&](long long int i, int& cluster, double& x, double& y, double& w) {
+            cluster = (int)points[i][2];
+            x = points[i][0];
+            y = points[i][1];
+            w = 1.0;
+        }, sums, totals);
+        for (int j = 0; j < num_clusters; j++) {
+            if (totals[j] > 0.0) {
+                centroids[j][0] = sums[2 * j] / totals[j];
+                centroids[j][1] = sums[2 * j + 1] / totals[j];
+            }
+        }
+
+        // Converge auxiliar variable, cleared when any point changes cluster
+        bool converge = true;
+
+        // Indexing the moved centroids
+        CentroidGrid grid;
+        build_centroid_grid(centroids, num_clusters, grid);
+
+        // OpenMP Directive: each thread keeps one candidate list for all the blocks it assigns
+        #pragma omp parallel reduction(&& : converge)
+        {
+            vector<int> candidates;
+
+            // OpenMP Directive: each block is assigned by one thread, comparing only its candidate centroids
+            #pragma omp for schedule(dynamic)
+            for (long long int b = 0; b < blocks.num_blocks; b++) {
+
+                // Bounding the distance to the winner with the centroids of the clusters already in the block
+                const long long int first = b * blocks.block_size;
+                const long long int last = min(size, (b + 1) * blocks.block_size);
+                double cota = INFINITY;
+                int previous = -1;
+                for (long long int i = first; i < last; i++) {
+                    int j = (int)points[i][2];
+                    if (j >= 0 && j != previous) {
+                        double min_distancia, max_distancia;
+                        box_distances(blocks, b, centroids[j][0], centroids[j][1], min_distancia, max_distancia);
+                        cota = min(cota, max_distancia);
+                        previous = j;
+                    }
+                }
+
+                // Selecting the candidates through the grid (or among all the centroids if the block has no labels)
+                if (cota < INFINITY) {
+                    grid_candidates(blocks, b, centroids, grid, cota, candidates);
+                }
+                else {
+                    block_candidates(blocks, b, centroids, num_clusters, candidates);
+                }
+
+                // Assigning every point of the block to its closest candidate
+                for (long long int i = first; i < last; i++) {
+                    float min_distancia = INFINITY;
+                    int min_cluster = -1;
+                    for (int j : candidates) {
+                        float distancia_x = points[i][0] - centroids[j][0];
+                        float distancia_y = points[i][1] - centroids[j][1];
+                        float distancia = distancia_x * distancia_x + distancia_y * distancia_y;
+                        if (distancia < min_distancia) {
+                            min_distancia = distancia;
+                            min_cluster = j;
+                        }
+                    }
+                    if (min_cluster != points[i][2]) {
+                        points[i][2] = min_cluster;
+                        converge = false;
+                    }
+                }
+            }
+        }
+
+        // Stopping once no point changed cluster
+        if (converge) {
+            break;
+        }
+
+    }
+
+}
+
+/* 
+    DEFINING Pipelined Load and Save FUNCTIONS
+*/
+
+// Number of lines handled by one pipeline task, one REDUCTION_BLOCK so that every chunk falls inside a single
+// reduction group of cluster_sums
+const long long int PIPELINE_CHUNK = REDUCTION_BLOCK;
+
+// Number of rows after which a pipeline task publishes the CPU time it has used, so that the I/O thread sees how
+// much work the tasks did during each of its reads or writes
+const long long int PIPELINE_PROGRESS = 1024;
+
+/*
+    Time spent by a pipeline stage: io is the time the I/O thread spent reading or writing (without the time it was
+    ready but waiting for a core), compute the total CPU time of the parsing or formatting tasks, wall the elapsed
+    time of the whole stage, and hidden the part of io during which the tasks made progress. assign is the part of
+    compute spent in a final assignment done by the save stage
+*/
+struct PipelineStats {
+    double io = 0.0;
+    double compute = 0.0;
+    double wall = 0.0;
+    double hidden = 0.0;
+    double assign = 0.0;
+};
+
+/*
+    CPU time consumed by the calling thread. Pipeline tasks are measured with it so that the time a task spends
+    waiting for a core is not counted as work
+*/
+double thread_cpu_time() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+/*
+    Time the calling thread has spent ready to run but waiting for a core (second field of the Linux schedstat
+    file). It is subtracted from the I/O calls, so that an I/O thread pushed off its core by the tasks does not
+    count that time as I/O. Returns 0 where the file is not available
+*/
+double thread_wait_time() {
+    ifstream in("/proc/thread-self/schedstat");
+    unsigned long long int run = 0, wait = 0;
+    in >> run >> wait;
+    return 1e-9 * wait;
+}
+
+/*
+    Timing of one read or write of the I/O thread. done is the CPU time the tasks have published so far; the tasks
+    ran during the call for as long as done grew, and the call is hidden up to that amount, one task at a time at
+    most (several tasks running in parallel hide the call no more than one)
+*/
+void time_io_call(const double& done, PipelineStats& stats, const function<void()>& call) {
+
+    // State before the call
+    double start_done;
+    #pragma omp atomic read
+    start_done = done;
+    double start_wait = thread_wait_time();
+    double start_io = omp_get_wtime();
+
+    // Reading or writing
+    call();
+
+    // Time the I/O thread was actually doing I/O, and task work done meanwhile
+    double io = max(0.0, (omp_get_wtime() - start_io) - (thread_wait_time() - start_wait));
+    double end_done;
+    #pragma omp atomic read
+    end_done = done;
+
+    // Accumulating the times of the call
+    stats.io += io;
+    stats.hidden += min(io, end_done - start_done);
+
+}
+
+/*
+    Finishing the times of a pipeline stage. The hidden time is also bounded by how much the stage actually saved:
+    on a single core the tasks only run while the I/O thread is not, and io + compute then does not exceed wall
+*/
+void finish_pipeline_stats(double start, double compute, PipelineStats& stats) {
+    stats.compute = compute;
+    stats.wall = omp_get_wtime() - start;
+    stats.hidden = min(stats.hidden, max(0.0, stats.io + stats.compute - stats.wall));
+}
+
+/*
+    Number of chunk buffers in flight between the I/O thread and the tasks. When all of them are busy the I/O thread
+    waits for the oldest one, which bounds the memory held by the pipeline (back-pressure)
+*/
+int pipeline_depth() {
+    return 2 * omp_get_max_threads() + 1;
+}
+
+/*
+    Reading data from a CSV file with the parsing overlapped with the reading. One thread reads chunks of
+    PIPELINE_CHUNK lines and hands each chunk to a task that parses it into the point store. When initial_sums is not
+    null, the tasks also draw the initial random labels of their points and accumulate the per-cluster sums of those
+    labels, which kmeans_paralelo then uses for its first iteration. Returns false, with initial_sums untouched, when
+    the file cannot be read
+*/
+bool load_CSV_pipeline(string file_name, float** points, long long int size, int num_clusters, unsigned long long int seed, ClusterSums* initial_sums, PipelineStats& stats) {
+
+    // Starting time measurement of the stage
+    double start = omp_get_wtime();
+
+    // Opening the CSV file
+    ifstream in(file_name);
+
+    // Checking if the file was sucessfully opened
+    if (!in) {
+
+        // Priting message of unsucessful open file
+        cerr << "Couldn't read file: " << file_name << "\n";
+
+        // Exit the function
+        return false;
+
+    }
+
+    // Number of chunks and number of buffers in flight
+    const long long int num_chunks = (size + PIPELINE_CHUNK - 1) / PIPELINE_CHUNK;
+    const int depth = pipeline_depth();
+
+    // Line buffers, reused round-robin; slots[s] is the task dependency that protects buffers[s]
+    // (only named in depend clauses, which the unused-variable check does not see)
+    vector<vector<string>> buffers(depth);
+    vector<char> slot_tokens(depth);
+    [[maybe_unused]] char* slots = slot_tokens.data();
+
+    // Partial sums of every reduction group, filled by the tasks; groups[g] is the task dependency that makes the
+    // chunks of group g add their sums in file order, as cluster_sums does
+    const long long int group_size = group_blocks(size) * REDUCTION_BLOCK;
+    const long long int num_groups = (size + group_size - 1) / group_size;
+    vector<double> partial((initial_sums != nullptr) ? num_groups * 3 * (long long int)num_clusters : 0, 0.0);
+    vector<char> group_tokens(num_groups);
+    [[maybe_unused]] char* groups = group_tokens.data();
+
+    // Total time of the parsing tasks
+    double compute = 0.0;
+
+    // OpenMP Directive: one thread of the team reads the file and creates the tasks, the others run the tasks
+    #pragma omp parallel
+    #pragma omp single
+    {
+        // Declaring line variable to store each line read from the file
+        string line;
+
+        // For loop over the chunks of the file
+        for (long long int c = 0; c < num_chunks; c++) {
+
+            // Buffer of this chunk
+            const int s = c % depth;
+
+            // OpenMP Directive: waiting until the task that used this buffer (chunk c - depth) has finished
+            #pragma omp taskwait depend(in : slots[s])
+
+            // Range of points of the chunk
+            const long long int first = c * PIPELINE_CHUNK;
+            const long long int last = min(size, first + PIPELINE_CHUNK);
+
+            // Reading the lines of the chunk (fewer, or none, at the end of a short file)
+            time_io_call(compute, stats, [&] {
+                buffers[s].clear();
+                while (first + (long long int)buffers[s].size() < last && getline(in, line)) {
+                    buffers[s].push_back(line);
+                }
+            });
+
+            // OpenMP Directive: parsing the chunk in a task that owns the buffer until it finishes
+            #pragma omp task firstprivate(first, last, s) depend(out : slots[s])
+            {
+                // Starting time measurement of the task
+                double start_task = thread_cpu_time();
+
+                // Parsing the lines that were read, publishing the CPU time used every PIPELINE_PROGRESS lines
+                const vector<string>& lines = buffers[s];
+                for (long long int i = 0; i < (long long int)lines.size(); i++) {
+                    parse_line(lines[i], points[first + i]);
+                    if ((i + 1) % PIPELINE_PROGRESS == 0) {
+                        double now = thread_cpu_time();
+                        #pragma omp atomic
+                        compute += now - start_task;
+                        start_task = now;
+                    }
+                }
+
+                // Drawing the initial labels exactly as kmeans_paralelo does, if they have to be prepared
+                if (initial_sums != nullptr) {
+                    for (long long int i = first; i < last; i++) {
+                        points[i][2] = random_int(seed, STREAM_INITIAL_LABELS, i, num_clusters);
+                    }
+                }
+
+                // OpenMP Directive: the task times are added by several threads
+                #pragma omp atomic
+                compute += thread_cpu_time() - start_task;
+            }
+
+            // Checking if the sums of the initial labels have to be prepared
+            if (initial_sums != nullptr) {
+
+                // Reduction group of the chunk
+                const long long int g = first / group_size;
+
+                // OpenMP Directive: accumulating the chunk once it is parsed, after the earlier chunks of its group
+                #pragma omp task firstprivate(first, last, g) depend(in : slots[s]) depend(inout : groups[g])
+                {
+                    // Starting time measurement of the task
+                    double start_task = thread_cpu_time();
+
+                    // Adding the points of the chunk to the partial sums of the group
+                    cluster_block_sums(first, last, [&](long long int i, int& cluster, double& x, double& y, double& w) {
+                        cluster = (int)points[i][2];
+                        x = points[i][0];
+                        y = points[i][1];
+                        w = 1.0;
+                    }, partial.data() + g * 3 * (long long int)num_clusters);
+
+                    // OpenMP Directive: the task times are added by several threads
+                    #pragma omp atomic
+                    compute += thread_cpu_time() - start_task;
+                }
+
+            }
+
+        }
+    }
+
+    // Closing the file after reading all necessary data
+    in.close();
+
+    // Combining the partial sums of the initial labels
+    if (initial_sums != nullptr) {
+        combine_cluster_sums(partial, num_groups, num_clusters, initial_sums->sums, initial_sums->totals);
+    }
+
+    // Storing the times of the stage
+    finish_pipeline_stats(start, compute, stats);
+
+    // File read
+    return true;
+
+}
+
+/*
+    Writing data to a CSV file with the formatting overlapped with the writing. Tasks format chunks of PIPELINE_CHUNK
+    rows into text while one thread writes the finished chunks in order. When assign is not null, each task first
+    labels its points with it, so the final assignment pass also overlaps the writing. order has the same meaning as
+    in save_to_CSV
+*/
+void save_to_CSV_pipeline(string file_name, float** points, long long int size, const long long int* order, const function<int(const float*)>* assign, PipelineStats& stats) {
+
+    // Starting time measurement of the stage
+    double start = omp_get_wtime();
+
+    // Opening the output file
+    ofstream fout(file_name);
+
+    // Checking if the file was successfully opened for writing
+    if (!fout) {
+
+        // Priting message of unsucessful open file
+        cerr << "Couldn't write to file: " << file_name << "\n";
+
+        // Exit the function
+        return;
+
+    }
+
+    // Declaring the inverse permutation, mapping each original row to the position where it is stored now
+    vector<long long int> inverse;
+
+    // Checking if the points were reordered
+    if (order != nullptr) {
+        invert_order(order, size, inverse);
+    }
+
+    // Number of chunks and number of buffers in flight
+    const long long int num_chunks = (size + PIPELINE_CHUNK - 1) / PIPELINE_CHUNK;
+    const int depth = pipeline_depth();
+
+    // Text buffers, reused round-robin; slots[s] is the task dependency that protects buffers[s]
+    // (only named in depend clauses, which the unused-variable check does not see)
+    vector<string> buffers(depth);
+    vector<char> slot_tokens(depth);
+    [[maybe_unused]] char* slots = slot_tokens.data();
+
+    // Total time of the formatting tasks, and the part of it spent assigning
+    double compute = 0.0;
+    double assigned = 0.0;
+
+    // OpenMP Directive: one thread of the team creates the tasks and writes, the others run the tasks
+    #pragma omp parallel
+    #pragma omp single
+    {
+        // For loop over the chunks, plus depth extra steps that write the last chunks
+        for (long long int c = 0; c < num_chunks + depth; c++) {
+
+            // Buffer of this chunk
+            const int s = c % depth;
+
+            // Checking if the buffer holds a chunk (c - depth) that has to be written before it is reused
+            if (c >= depth) {
+
+                // OpenMP Directive: waiting until chunk c - depth has been formatted
+                #pragma omp taskwait depend(in : slots[s])
+
+                // Writing the chunk
+                time_io_call(compute, stats, [&] {
+                    fout << buffers[s];
+                });
+
+            }
+
+            // Checking if there is still a chunk to format
+            if (c < num_chunks) {
+
+                // OpenMP Directive: formatting the chunk in a task that owns the buffer until it finishes
+                #pragma omp task firstprivate(c, s) depend(out : slots[s])
+                {
+                    // Starting time measurement of the task
+                    double start_task = thread_cpu_time();
+
+                    // Final assignment of the rows of the chunk, if requested, timed on its own
+                    if (assign != nullptr) {
+
+                        // Assigning every row, publishing the CPU time used every PIPELINE_PROGRESS rows
+                        double assign_time = 0.0;
+                        for (long long int i = c * PIPELINE_CHUNK; i < min(size, (c + 1) * PIPELINE_CHUNK); i++) {
+                            if (i > c * PIPELINE_CHUNK && i % PIPELINE_PROGRESS == 0) {
+                                double now = thread_cpu_time();
+                                assign_time += now - start_task;
+                                #pragma omp atomic
+                                compute += now - start_task;
+                                start_task = now;
+                            }
+                            float* point = (order != nullptr) ? points[inverse[i]] : points[i];
+                            point[2] = (*assign)(point);
+                        }
+
+                        // Publishing the rest of the assignment time
+                        double now = thread_cpu_time();
+                        assign_time += now - start_task;
+                        #pragma omp atomic
+                        compute += now - start_task;
+                        start_task = now;
+
+                        // OpenMP Directive: the assignment times are added by several threads
+                        #pragma omp atomic
+                        assigned += assign_time;
+
+                    }
+
+                    // Formatting the rows of the chunk exactly as save_to_CSV does, publishing the CPU time used
+                    // every PIPELINE_PROGRESS rows
+                    ostringstream text;
+                    for (long long int i = c * PIPELINE_CHUNK; i < min(size, (c + 1) * PIPELINE_CHUNK); i++) {
+
+                        // Publishing the CPU time used so far
+                        if (i > c * PIPELINE_CHUNK && i % PIPELINE_PROGRESS == 0) {
+                            double now = thread_cpu_time();
+                            #pragma omp atomic
+                            compute += now - start_task;
+                            start_task = now;
+                        }
+
+                        // Selecting the stored point that belongs to the ith row of the original file
+                        const float* point = (order != nullptr) ? points[inverse[i]] : points[i];
+
+                        // Writing the x-coordindate, the y-coordinate and the cluster id
+                        text << point[0] << "," << point[1] << "," << point[2] << "\n";
+
+                    }
+                    buffers[s] = text.str();
+
+                    // OpenMP Directive: the task times are added by several threads
+                    #pragma omp atomic
+                    compute += thread_cpu_time() - start_task;
+                }
+
+            }
+
+        }
+    }
+
+    // Closing the file
+    fout.close();
+
+    // Storing the times of the stage
+    finish_pipeline_stats(start, compute, stats);
+    stats.assign = assigned;
+
+}
+
+/* 
+    MAIN
+*/
+
+int main(int argc, char** argv) {
+
+    // Command line argument validation: if fewer than 4 arguments are provided
+    if (argc < 4) {
+
+        // Displaying usage message
+        cerr << "Usage: " << argv[0] << " <data_file.csv> <num_clusters> <output_file.csv> [num_threads] [--sfc=morton|hilbert] [--coreset=<size>] [--compare] [--seed=<n>]\n"
+             << "       [--checkpoint=<file>] [--checkpoint-every=<n>] [--checkpoint-labels] [--resume] [--pipeline]\n"
+             << "       [--hierarchical] [--refine=<iterations>]\n";
+
+        // Program exit
+        return 1;
+
+    }
+
+    // Converting the first command-line argument (argv[1]) into a long long int representing the size (number of data points)
+    const long long int size = atoll(argv[1]);
+
+    // Converting the second command-line argument (argv[2]) into an integer that represents the number of clusters (num_clusters) to be used in the K-means algorithm
+    const int num_clusters = atoi(argv[2]);
+
+    // Storing the first command-line argument (argv[1]) as input_file_name
+    const string input_file_name = argv[1];
+
+    // Storing the third command-line argument (argv[3]) as output_file_name_paralelo
+    const string output_file_name_paralelo = argv[3];
+
+    // Setting a constant max_iterations to 20, defining a cap on the number of iterations the K-means algorithm will perform
+    const int max_iterations = 20;
+
+    // Cap on the number of weighted Lloyd iterations on the coreset, which are cheap because the coreset is small
+    const int max_iterations_coreset = 100;
+
+    // Determining the maximum number of threads
+    int num_threads = omp_get_max_threads();
+
+    // Number of weighted points of the coreset (0 clusters the full data set directly)
+    long long int coreset_size = 0;
+
+    // Whether the coreset result is compared against the same weighted Lloyd run on the full data set
+    bool compare = false;
+
+    // Seed of every random draw; a fixed seed gives bit-identical results at any number of threads
+    unsigned long long int seed = 0;
+
+    // Whether the seed was given on the command line
+    bool seed_given = false;
+
+    // Space-filling curve used to reorder the points before clustering (none by default)
+    int curve = CURVE_NONE;
+
+    // Path of the checkpoint file (no checkpoints when empty)
+    string checkpoint_file;
+
+    // Number of iterations between checkpoints (0 chooses it from the measured snapshot and iteration times)
+    int checkpoint_every = 0;
+
+    // Whether the labels are stored with the checkpoints
+    bool checkpoint_labels = false;
+
+    // Whether the run continues from the checkpoint file
+    bool resume = false;
+
+    // Whether loading and saving are pipelined with the computation
+    bool pipeline = false;
+
+    // Whether the clusters are built by recursive bisection
+    bool hierarchical = false;
+
+    // Number of flat Lloyd iterations that refine the hierarchical clusters
+    int refine_iterations = 0;
+
+    // For loop over the optional command-line arguments that follow the output file
+    for (int a = 4; a < argc; a++) {
+
+        // Storing the argument as a string to compare it against the known options
+        const string arg = argv[a];
+
+        // Reordering the points along a Morton (Z-order) curve
+        if (arg == "--sfc=morton") {
+            curve = CURVE_MORTON;
+        }
+        // Reordering the points along a Hilbert curve
+        else if (arg == "--sfc=hilbert") {
+            curve = CURVE_HILBERT;
+        }
+        // Clustering a coreset of the given size instead of the full data set
+        else if (arg.rfind("--coreset=", 0) == 0) {
+            coreset_size = atoll(arg.c_str() + 10);
+        }
+        // Also running the weighted Lloyd on the full data set to report the inertia gap of the coreset
+        else if (arg == "--compare") {
+            compare = true;
+        }
+        // Fixing the seed of the random draws
+        else if (arg.rfind("--seed=", 0) == 0) {
+            seed = strtoull(arg.c_str() + 7, nullptr, 10);
+            seed_given = true;
+        }
+        // Writing checkpoints to the given file
+        else if (arg.rfind("--checkpoint=", 0) == 0) {
+            checkpoint_file = arg.substr(13);
+        }
+        // Setting the number of iterations between checkpoints
+        else if (arg.rfind("--checkpoint-every=", 0) == 0) {
+            checkpoint_every = max(1, atoi(arg.c_str() + 19));
+        }
+        // Storing the labels with the checkpoints; copying every label costs a full pass over the points, so the
+        // automatic interval spaces these checkpoints out (about 9% of the run if forced with --checkpoint-every=1)
+        else if (arg == "--checkpoint-labels") {
+            checkpoint_labels = true;
+        }
+        // Continuing from the checkpoint file
+        else if (arg == "--resume") {
+            resume = true;
+        }
+        // Overlapping the parsing and the formatting with the file I/O
+        else if (arg == "--pipeline") {
+            pipeline = true;
+        }
+        // Building the clusters by recursive bisection
+        else if (arg == "--hierarchical") {
+            hierarchical = true;
+        }
+        // Refining the hierarchical clusters with flat Lloyd iterations
+        else if (arg.rfind("--refine=", 0) == 0) {
+            refine_iterations = max(0, atoi(arg.c_str() + 9));
+        }
+        // Rejecting unknown options
+        else if (arg.rfind("--", 0) == 0) {
+            cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+        // Any other argument is the number of threads, converted from a string to an integer
+        else {
+            num_threads = atoi(argv[a]);
+        }
+
+    }
+
+    // The coreset must hold at least one point per cluster
+    if (coreset_size > 0 && coreset_size < num_clusters) {
+        coreset_size = num_clusters;
+    }
+
+    // Checking that resuming has a checkpoint file to read
+    if (resume && checkpoint_file.empty()) {
+        cerr << "--resume needs --checkpoint=<file>\n";
+        return 1;
+    }
+
+    // Checking that checkpoints are only requested for the full clustering, the only one that writes them
+    if (coreset_size > 0 && !checkpoint_file.empty()) {
+        cerr << "--coreset cannot be combined with --checkpoint or --resume\n";
+        return 1;
+    }
+
+    // Checking the options that the hierarchical mode does not combine with
+    if (hierarchical && (coreset_size > 0 || !checkpoint_file.empty())) {
+        cerr << "--hierarchical cannot be combined with --coreset or --checkpoint\n";
+        return 1;
+    }
+
+    // Checking that every cluster can receive at least one point
+    if (hierarchical && num_clusters > size) {
+        cerr << "--hierarchical needs at most one cluster per point\n";
+        return 1;
+    }
+
+    // Setting the Number of Threads for OpenMP
+    omp_set_num_threads(num_threads);
+
+    // State read from the checkpoint file when resuming
+    Checkpoint estado;
+
+    // Whether a checkpoint was actually read
+    bool reanudar = false;
+
+    // Checking if the run has to continue from a checkpoint
+    if (resume) {
+
+        // Reading the checkpoint; without one the run starts from scratch
+        reanudar = load_checkpoint(checkpoint_file, size, max_iterations, estado);
+        if (!reanudar) {
+            cerr << "Starting from scratch\n";
+        }
+
+        // Checking that the checkpoint belongs to this data set, number of clusters and point order
+        if (reanudar && (estado.size != size || estado.num_clusters != num_clusters || estado.layout != curve
+                         || (!estado.labels.empty() && (long long int)estado.labels.size() != size))) {
+            cerr << "Checkpoint " << checkpoint_file << " does not match this data set, number of clusters or --sfc option\n";
+            return 1;
+        }
+
+        // The random streams of the remaining iterations depend on the seed of the interrupted run
+        if (reanudar) {
+            seed = estado.seed;
+            seed_given = true;
+            cout << "Reanudando desde la iteración " << estado.iteration << "\n";
+        }
+
+    }
+
+    // Checking if the seed has to be generated
+    if (!seed_given) {
+
+        // Generating the seed from a uniformly-distributed random number
+        std::random_device rd;
+        seed = ((unsigned long long int)rd() << 32) | rd();
+
+    }
+
+    // Reporting the seed, so that any run can be reproduced with --seed
+    cout << "Semilla: " << seed << "\n";
+
+    // Starting time measurement of the whole run, from loading to saving
+    double start_total = omp_get_wtime();
+
+    // Allocating one contiguous block holding the three float values of every point, so that consecutive points
+    // are also consecutive in memory
+    float* almacen = new float[3 * size];
+
+    // Allocating dynamic memory for an array
+    float** paralelo = new float*[size];
+
+    // For loop iterating from 0 to size-1, where size presents the total number of data points to be processed
+    for (long long int i = 0; i < size; i++) {
+
+        // Pointing the ith entry of paralelo array to its three float values inside the contiguous block
+        paralelo[i] = almacen + 3 * i;
+        paralelo[i][0] = 0.0;
+        paralelo[i][1] = 0.0;
+        paralelo[i][2] = -1;
+                                                  
+    }
+
+    // Weighted points of the coreset, built while the file is read, and the time spent building it
+    Coreset coreset;
+    double tiempo_construccion = 0.0;
+
+    // Times of the pipelined load and save stages
+    PipelineStats carga, guardado;
+
+    // Per-cluster sums of the initial labels, accumulated by the pipelined loader
+    ClusterSums sumas_iniciales;
+
+    // The pipelined loader prepares the first iteration only when kmeans_paralelo starts from random labels in file order
+    bool preparar_primera = pipeline && coreset_size == 0 && !hierarchical && curve == CURVE_NONE && !reanudar;
+
+    // Checking if a coreset was requested
+    if (coreset_size > 0) {
+
+        // Reading the file and building the coreset in a single streaming pass
+        load_CSV_coreset(input_file_name, paralelo, size, coreset_size, seed, coreset, tiempo_construccion);
+
+        // Reporting the construction time, which is part of the cost of clustering with a coreset
+        cout << "Tiempo de construcción del coreset: " << tiempo_construccion << "\n";
+
+    }
+    // Checking if the load is pipelined
+    else if (pipeline) {
+
+        // Reading the file while tasks parse it (and draw the initial labels and their sums); if it cannot be read
+        // there are no sums, and kmeans_paralelo draws the labels itself as in the non-pipelined run
+        if (!load_CSV_pipeline(input_file_name, paralelo, size, num_clusters, seed, preparar_primera ? &sumas_iniciales : nullptr, carga)) {
+            preparar_primera = false;
+        }
+
+    }
+    else {
+
+        // Using our load_csv function 
+        load_CSV(input_file_name, paralelo, size);
+
+    }
+
+    // Original row of each stored point, filled only when the points are reordered
+    vector<long long int> order;
+
+    // Bounding boxes of the blocks of reordered points
+    PointBlocks blocks;
+
+    // Checking if a space-filling curve was requested
+    if (curve != CURVE_NONE) {
+
+        // Starting time measurement of the reordering
+        double start_reorden = omp_get_wtime();
+
+        // Sorting the point store along the curve and computing the block boxes
+        reorder_points(paralelo, size, curve, order, blocks);
+
+        // Reporting the reordering time
+        cout << "Tiempo de reordenamiento: " << omp_get_wtime() - start_reorden << "\n";
+
+    }
+
+    // Starting time measuremente
+    double start_paralelo = omp_get_wtime();
+
+    // Centroids found on the coreset, or centroids of the flat iteration whose assignment the save stage does
+    vector<float> centroids;
+
+    // With a pipelined save the final assignment of the coreset mode runs inside the save stage, unless the labels
+    // are needed earlier to compare inertias
+    const bool asignar_al_guardar = pipeline && coreset_size > 0 && !compare;
+
+    // Checking if the clustering runs on the coreset
+    if (coreset_size > 0) {
+
+        // Clustering the coreset with weighted Lloyd
+        kmeans_ponderado(coreset, num_clusters, max_iterations_coreset, seed, centroids);
+
+        // Final assignment pass over the full data set
+        if (!asignar_al_guardar) {
+            assign_points(paralelo, size, centroids, num_clusters);
+        }
+
+    }
+    // Checking if the clustering is hierarchical
+    else if (hierarchical) {
+
+        // The bisection permutes the point store, so the original row of every point has to be tracked
+        if (order.empty()) {
+            order.resize(size);
+            for (long long int i = 0; i < size; i++) {
+                order[i] = i;
+            }
+        }
+
+        // Building the clusters by recursive bisection
+        kmeans_jerarquico(paralelo, num_clusters, size, seed, order);
+
+        // Checking if a flat refinement was requested
+        if (refine_iterations > 0) {
+
+            // Every cluster is now a contiguous slice, so blocks about the size of a cluster have tight boxes that
+            // only a few neighbouring centroids can reach
+            blocks.block_size = max(REFINE_MIN_BLOCK, min(BLOCK_SIZE, size / num_clusters));
+            build_blocks(paralelo, size, blocks);
+
+            // Refining the clusters with flat Lloyd iterations
+            refine_lloyd(paralelo, size, num_clusters, refine_iterations, blocks);
+
+        }
+
+    }
+    else {
+
+        // Starting the background checkpoint writer, if requested
+        CheckpointWriter* escritor = checkpoint_file.empty() ? nullptr : new CheckpointWriter(checkpoint_file, checkpoint_every, checkpoint_labels, curve);
+
+        // Executing the K-means Clustering Algorithm; with a pipelined save, the assignment of a last iteration that
+        // reaches max_iterations is left to the save stage and its centroids are returned in centroids
+        kmeans_paralelo(paralelo, num_clusters, size, max_iterations, seed, (curve != CURVE_NONE) ? &blocks : nullptr,
+                        escritor, reanudar ? &estado : nullptr, preparar_primera ? &sumas_iniciales : nullptr,
+                        order.empty() ? nullptr : order.data(), pipeline ? &centroids : nullptr);
+
+        // Checking if checkpoints were written
+        if (escritor != nullptr) {
+
+            // Reporting the time the compute loop spent handing checkpoints over
+            cout << "Tiempo en checkpoints: " << escritor->submit_time << "\n";
+
+            // Waiting for the last checkpoint to be written and stopping the writer thread
+            delete escritor;
+
+        }
+
+    }
+
+    // Measuring Execution Time
+    double tiempo_ejecucion_paralelo = omp_get_wtime() - start_paralelo;
+
+    //Reporting Execution Time
+    cout << "Tiempo de ejecución en paralelo: " << tiempo_ejecucion_paralelo << "\n";
+
+    // With a pipelined save the final assignment may be left to the save stage (see save_to_CSV_pipeline), in which
+    // case the time above does not include it and is not comparable with a non-pipelined run
+    const bool asignacion_en_guardado = asignar_al_guardar || (pipeline && coreset_size == 0 && !hierarchical && !centroids.empty());
+    if (asignacion_en_guardado) {
+        cout << "  (sin la asignación final, que se hace en la etapa de guardado)\n";
+    }
+
+    // Reporting the inertia of the hierarchical clusters
+    if (hierarchical) {
+        cout << "Inercia: " << compute_inertia(paralelo, size, num_clusters) << "\n";
+    }
+
+    // Checking if the coreset result has to be compared against the same clustering of the full data set
+    if (coreset_size > 0 && compare) {
+
+        // The reference is the same weighted Lloyd (same seed, same iteration cap) run on every point with weight one,
+        // so the gap measures only what the coreset loses
+        Coreset completo_ponderado;
+        completo_ponderado.coords.resize(2 * size);
+        completo_ponderado.weights.assign(size, 1.0);
+
+        // Copying the points into a second store for the reference labels, and into the weighted set
+        float* almacen_completo = new float[3 * size];
+        float** completo = new float*[size];
+        for (long long int i = 0; i < size; i++) {
+            completo[i] = almacen_completo + 3 * i;
+            completo[i][0] = paralelo[i][0];
+            completo[i][1] = paralelo[i][1];
+            completo[i][2] = -1;
+            completo_ponderado.coords[2 * i] = paralelo[i][0];
+            completo_ponderado.coords[2 * i + 1] = paralelo[i][1];
+        }
+
+        // Running and timing the reference clustering on the full data set
+        double start_completo = omp_get_wtime();
+        vector<float> centroids_completos;
+        kmeans_ponderado(completo_ponderado, num_clusters, max_iterations_coreset, seed, centroids_completos);
+        assign_points(completo, size, centroids_completos, num_clusters);
+        double tiempo_completo = omp_get_wtime() - start_completo;
+
+        // Computing the inertia of both clusterings
+        double inercia_coreset = compute_inertia(paralelo, size, num_clusters);
+        double inercia_completa = compute_inertia(completo, size, num_clusters);
+
+        // Reporting the times (the coreset one including its construction) and the relative inertia gap of the coreset
+        cout << "Tiempo de ejecución con coreset (construcción incluida): " << tiempo_construccion + tiempo_ejecucion_paralelo << "\n";
+        cout << "Tiempo de ejecución completo: " << tiempo_completo << "\n";
+        cout << "Inercia con coreset: " << inercia_coreset << "\n";
+        cout << "Inercia completa: " << inercia_completa << "\n";
+        cout << "Diferencia de inercia: " << 100.0 * (inercia_coreset - inercia_completa) / inercia_completa << "%\n";
+
+        // Deallocating the second store
+        delete[] almacen_completo;
+        delete[] completo;
+
+    }
+    
+    // Checking if the save is pipelined
+    if (pipeline) {
+
+        // Final assignment done by the formatting tasks, if it is still pending, and the rows of the centroids in the
+        // form closest_centroid reads them
+        function<int(const float*)> asignar;
+        vector<const float*> filas;
+
+        // Coreset mode: nearest centroid found on the coreset
+        if (asignar_al_guardar) {
+            asignar = [&](const float* point) {
+                return nearest_centroid(point[0], point[1], centroids, num_clusters);
+            };
+        }
+        // Flat mode stopped by max_iterations: the same search as the assignment step of kmeans_paralelo, so the
+        // labels are the ones it would have written
+        else if (asignacion_en_guardado) {
+            filas.resize(num_clusters);
+            for (int j = 0; j < num_clusters; j++) {
+                filas[j] = centroids.data() + 2 * j;
+            }
+            asignar = [&](const float* point) {
+                return closest_centroid(point, filas.data(), nullptr, num_clusters);
+            };
+        }
+
+        // Formatting the rows in tasks (after assigning them, if pending) while the finished chunks are written
+        save_to_CSV_pipeline(output_file_name_paralelo, paralelo, size, order.empty() ? nullptr : order.data(),
+                             asignar ? &asignar : nullptr, guardado);
+
+        // Time of the run, and time of parsing, formatting and I/O that did not add to it because it overlapped
+        double tiempo_total = omp_get_wtime() - start_total;
+        double oculto = carga.hidden + guardado.hidden;
+
+        // Reporting the stage times and the hidden time
+        cout << "Tiempo de carga: " << carga.wall << " (lectura " << carga.io << ", procesamiento " << carga.compute << ")\n";
+        cout << "Tiempo de guardado: " << guardado.wall << " (escritura " << guardado.io << ", formato " << guardado.compute << ")\n";
+        if (asignacion_en_guardado) {
+            cout << "Tiempo de la asignación final en el guardado (CPU de las tareas): " << guardado.assign << "\n";
+        }
+        cout << "Tiempo total: " << tiempo_total << "\n";
+        cout << "Tiempo oculto por el solapamiento con la E/S: " << oculto << " (" << 100.0 * oculto / tiempo_total << "% del tiempo total)\n";
+
+    }
+    else {
+
+        // Saving Results to a CSV File
+        save_to_CSV(output_file_name_paralelo, paralelo, size, order.empty() ? nullptr : order.data());
+
+    }
+
+    // Deallocating the contiguous block holding the points
+    delete[] almacen;
+
     // Deleting the outer array
     delete[] paralelo;
 